@@ -18,6 +18,17 @@
 #include <cstring>
 #include <memory>
 #include <typeindex>
+#include <vector>
+#include <functional>
+#include <utility>
+#include <atomic>
+#include <mutex>
+#include <cstddef>
+#include <stdint.h>
+#include <new>
+#include <algorithm>
+#include <tuple>
+#include <type_traits>
 
 namespace ioc
 {
@@ -29,357 +40,3647 @@ namespace ioc
 
     class container;
 
-    // ifactory is the base interface for a factory 
-    // type. CreateItem returns a void * which can
-    // then be reinterpret_cast'd to the required type.
-    class ifactory 
+    // type_slot hands out a small dense id for each type the first
+    // time it is asked for one. Ids are process wide and never reused
+    // so they can index registration arrays directly instead of
+    // hashing or comparing type_info objects.
+    class type_slot_counter
     {
-        public:
-            virtual ~ifactory(){}
-            virtual const std::type_info &get_type() const = 0;
-            virtual const std::string &get_name() const = 0;
-            virtual void* create_item() const = 0;
+        private:
+            template<typename T>
+                friend struct type_slot;
+
+            static size_t next()
+            {
+                static std::atomic<size_t> counter( 0 );
+                return counter++;
+            }
     };
 
-    // BaseFatory extends ifactory to provide some standard
-    // functionality that is required by most concrete
-    // factoy types.
-    template<typename I>
-        class base_factory : public ifactory
+    template<typename T>
+        struct type_slot
+        {
+            static size_t id()
+            {
+                static const size_t value = type_slot_counter::next();
+                return value;
+            }
+        };
+
+    // name_view refers to a registration name without owning it,
+    // so names can be looked up from string literals and strings
+    // alike without building a temporary std::string. The viewed
+    // characters must outlive the name_view.
+    class name_view
     {
         private:
-            std::string name;
-            virtual I *internal_create_item() const = 0;
+            const char *chars;
+            size_t length;
 
         public:
+            name_view( const char *chars_in ) 
+                : chars( chars_in ), length( strlen( chars_in ) )
+            {
+            }
 
-            base_factory( const std::string &name_in ) 
-                : ifactory(), name( name_in )
+            name_view( const std::string &name_in ) 
+                : chars( name_in.data() ), length( name_in.size() )
             {
             }
 
-            ~base_factory()
+            name_view( const char *chars_in, size_t length_in ) 
+                : chars( chars_in ), length( length_in )
             {
             }
 
-            const std::type_info &get_type() const
+            const char *data() const
             {
-                return typeid(I);
+                return chars;
             }
 
-            const std::string &get_name() const
+            size_t size() const
             {
-                return name;
+                return length;
             }
 
-            void *create_item() const
+            std::string str() const
             {
-                return static_cast<void *>( internal_create_item() );
+                return std::string( chars, length );
             }
-    };
 
-    template<size_t index>
-        struct recursive_resolve_impl;
+            bool operator==( const name_view &other ) const
+            {
+                return length == other.length && 
+                    memcmp( chars, other.chars, length ) == 0;
+            }
 
-    template<>
-        struct recursive_resolve_impl<0>
-        {
-            template<typename resolver_type, typename t, typename callable_type>
-                static t *resolve(resolver_type &resolver, callable_type callable)
-                {
-                    return callable();
-                }
-        };
+            bool operator!=( const name_view &other ) const
+            {
+                return !( *this == other );
+            }
+    };
 
-    template<size_t i>
-        struct recursive_resolve_impl
+    // 64 bit FNV-1a hash of a name. hash_name_constant gives the
+    // same result and can be evaluated at compile time.
+    inline uint64_t hash_name( const name_view &name )
+    {
+        uint64_t result = 14695981039346656037ULL;
+        for( size_t i = 0; i < name.size(); i++ )
         {
-            template<typename resolver_type, typename t, 
-                typename callable_type, typename ...argtypes>
-                    static t *resolve(resolver_type &resolver, callable_type callable)
-                    {
-                        return callable(resolver.template resolve<argtypes>()...);
-                    }
-        };
+            result ^= static_cast<unsigned char>( name.data()[i] );
+            result *= 1099511628211ULL;
+        }
+        return result;
+    }
 
-    struct recursive_resolve
+    constexpr uint64_t hash_name_constant( const char *chars, size_t length,
+            uint64_t result = 14695981039346656037ULL )
     {
-        template<typename t, typename resolver_type, 
-            typename callable_type, typename ...argtypes>
-                static t *resolve(resolver_type &resolver, callable_type callable)
-                {
-                    return recursive_resolve_impl<sizeof...(argtypes)>
-                        ::template resolve<resolver_type, t, callable_type, argtypes...>(resolver, callable);
-                }
-    };
+        return length == 0 ? result : hash_name_constant( chars + 1, length - 1,
+                ( result ^ static_cast<unsigned char>( *chars ) ) * 1099511628211ULL );
+    }
 
-    // DelegateFactory allows delegate objects or routines to be
-    // supplied and called for object construction. All delegate
-    // arguments are resolved by the resolver before being send
-    // to the delegate instance.
-    template<typename I, typename callable, typename ...argtypes>
-        class delegate_factory : public base_factory<I>
+    // hashed_name is the compile time hash of a registration name,
+    // usually written as a literal such as "replica"_ioc. Resolving
+    // through it compares integers only. Registering two names
+    // with the same hash in one container throws a
+    // name_collision_exception.
+    class hashed_name
     {
         private:
-            ioc::container &container_obj;
-            callable callable_obj;
+            uint64_t value;
 
-            I *internal_create_item() const
+        public:
+            constexpr explicit hashed_name( uint64_t value_in ) : value( value_in )
             {
-                // Resolve all variables for construction.
-                // If there is an error during resolution
-                // then the Resolver will de-allocate any
-                // already resolved objects for us.
+            }
 
-                //auto args =
-                //    tuple_resolve::
-                //        resolve<ioc::container, argtypes...>( container_obj );
-                //I *result = tuple_unwrap::call( callable_obj, args );
-                I *result = recursive_resolve
-                    ::resolve<I, ioc::container, callable, argtypes...>(container_obj, callable_obj);
-                return result;
+            constexpr uint64_t get() const
+            {
+                return value;
             }
+    };
 
-        public:
-            delegate_factory( const std::string &name_in, 
-                    ioc::container &container_in, const 
-                    callable &callable_obj_in )
-                : base_factory<I>( name_in ), container_obj( container_in ), 
-                callable_obj( callable_obj_in )
+    inline namespace literals
+    {
+        constexpr hashed_name operator"" _ioc( const char *chars, size_t length )
         {
+            return hashed_name( hash_name_constant( chars, length ) );
         }
+    }
 
-            ~delegate_factory()
+    // name_id is a compact handle for a registration name interned
+    // by a container, so resolving through it is an integer lookup.
+    // A default constructed name_id refers to no name. A handle is
+    // only meaningful to the container which issued it.
+    class name_id
+    {
+        private:
+            friend class container;
+
+            size_t value;
+
+            explicit name_id( size_t value_in ) : value( value_in )
+            {
+            }
+
+        public:
+            name_id() : value( 0 )
+            {
+            }
+
+            bool is_valid() const
+            {
+                return value != 0;
+            }
+
+            bool operator==( const name_id &other ) const
             {
+                return value == other.value;
             }
 
+            bool operator!=( const name_id &other ) const
+            {
+                return value != other.value;
+            }
     };
 
-    // ResolvableFactory extends DelegateFactory by supplying
-    // a standard function which can be used to instantiate
-    // and return an instance of a specific type.
-    template<typename I, typename T, typename ...argtypes>
-        class resolvable_factory 
-        : public delegate_factory<I, I* (*)( std::shared_ptr<argtypes>...), 
-        argtypes...>
+    // memory_resource is the source of memory for a container's own
+    // structures and, optionally, for the objects a registration
+    // constructs. It follows the interface of std::pmr::memory_resource
+    // so resources written for one are easily adapted to the other.
+    class memory_resource
     {
         private:
-            static I *creator(std::shared_ptr<argtypes>... args)
+            virtual void *do_allocate( size_t bytes, size_t alignment ) = 0;
+            virtual void do_deallocate( void *ptr, size_t bytes, size_t alignment ) = 0;
+
+            virtual bool do_is_equal( const memory_resource &other ) const
             {
-                return new T(args...);
+                return this == &other;
             }
+
         public:
-            typedef I *(func_type)(std::shared_ptr<argtypes>...);
+            virtual ~memory_resource()
+            {
+            }
 
-            resolvable_factory( 
-                    const std::string &name_in, 
-                    ioc::container &container_in )
-                : delegate_factory<I, I *(*)(std::shared_ptr<argtypes>...), argtypes...>
-                  ( name_in, container_in, resolvable_factory::creator )
-        {
-        }
+            void *allocate( size_t bytes, 
+                    size_t alignment = alignof( std::max_align_t ) )
+            {
+                return do_allocate( bytes, alignment );
+            }
 
-            ~resolvable_factory()
+            void deallocate( void *ptr, size_t bytes, 
+                    size_t alignment = alignof( std::max_align_t ) )
+            {
+                do_deallocate( ptr, bytes, alignment );
+            }
+
+            bool is_equal( const memory_resource &other ) const
             {
+                return do_is_equal( other );
             }
     };
 
-    // isntance_factory stores an instance of the required type.
-    // create_item simply returns the stored instance.
-    // It should be noted that there is no guard around the instance
-    // to stop it being deleted by some other object once it has
-    // been resolved.
-    template<typename I>
-        class instance_factory
-        : public base_factory<I>
+    // The default resource, which uses the global operator new
+    // and operator delete.
+    class new_delete_memory_resource : public memory_resource
+    {
+        private:
+            void *do_allocate( size_t bytes, size_t )
+            {
+                return ::operator new( bytes );
+            }
+
+            void do_deallocate( void *ptr, size_t, size_t )
+            {
+                ::operator delete( ptr );
+            }
+    };
+
+    inline memory_resource *new_delete_resource()
+    {
+        static new_delete_memory_resource resource;
+        return &resource;
+    }
+
+    // resource_allocator adapts a memory_resource to the standard
+    // allocator interface. A default constructed allocator uses
+    // new_delete_resource.
+    template<typename T>
+        class resource_allocator
         {
-            private: 
-                std::shared_ptr<I> instance;
+            private:
+                template<typename U>
+                    friend class resource_allocator;
+
+                memory_resource *source;
+
+            public:
+                typedef T value_type;
 
-                I *internal_create_item() const
+                resource_allocator() : source( new_delete_resource() )
                 {
-                    return instance.get();
                 }
 
-            public:
-                instance_factory( const std::string &name_in, std::shared_ptr<I> instance_in )
-                    : base_factory<I>( name_in ), instance( instance_in )
+                resource_allocator( memory_resource &source_in ) : source( &source_in )
                 {
                 }
 
-                ~instance_factory()
+                template<typename U>
+                    resource_allocator( const resource_allocator<U> &other ) 
+                    : source( other.source )
+                {
+                }
+
+                memory_resource *resource() const
+                {
+                    return source;
+                }
+
+                T *allocate( size_t n )
+                {
+                    return static_cast<T *>( 
+                            source->allocate( n * sizeof( T ), alignof( T ) ) );
+                }
+
+                void deallocate( T *ptr, size_t n )
                 {
+                    source->deallocate( ptr, n * sizeof( T ), alignof( T ) );
                 }
+
+                template<typename U>
+                    bool operator==( const resource_allocator<U> &other ) const
+                    {
+                        return source == other.source || source->is_equal( *other.source );
+                    }
+
+                template<typename U>
+                    bool operator!=( const resource_allocator<U> &other ) const
+                    {
+                        return !( *this == other );
+                    }
         };
 
-    // Registration exception classes
-    class registration_exception : public std::exception
+    // local_counted is a base for types which are only ever used on
+    // one thread. A local_ptr to such an object shares it with a
+    // plain, non-atomic count: the first local_ptr takes over the
+    // shared_ptr the object was resolved as and the last one lets it
+    // go, so copies in between touch no atomics.
+    class local_counted
     {
         private:
-            std::string type_name;
-            std::string registration_name;
-            std::string error;
-        public:
-            registration_exception( const std::string &type_name_in, 
-                    const std::string &registration_name_in )
-                : std::exception(), type_name( type_name_in ), 
-                registration_name( registration_name_in )
-        {
-            error = std::string( "Previous registration of type (Type: " ) +
-                    type_name + std::string( " , " ) + registration_name + 
-                    std::string( ")" );
-        }
+            template<typename T>
+                friend class local_ptr;
 
-            ~registration_exception() throw()
+            mutable std::shared_ptr<const void> owner;
+            mutable size_t local_references;
+
+        protected:
+            local_counted() : owner(), local_references( 0 )
             {
             }
 
-            const std::string &get_type_name() const
+            local_counted( const local_counted & ) : owner(), local_references( 0 )
             {
-                return type_name;
             }
 
-            const std::string &get_registration_name() const
+            local_counted &operator=( const local_counted & )
             {
-                return registration_name;
+                return *this;
             }
 
-            const char *what() const throw()
+            ~local_counted()
             {
-                return error.c_str(); 
             }
     };
 
-    // Container. All object types are registered with the container
-    // at run-time and can then be resolved. Resolver supports
-    // constructor injection.
-    class container
-    {
-        private:
-            template<typename T>
-            struct ellided_deleter
-            {
-                void operator()(T *val)
-                {
-                    // Shhhhh, don't actually delete the ptr.
-                }
-            };
-            typedef ellided_deleter<container> container_deleter;
-            
-            // Internal map of registered types -> map of named instances of
-            // type factories.
-            typedef std::map<std::string, ifactory*> named_factory;
-            typedef std::map<std::type_index, named_factory> registration_types;
+    // local_ptr is an owning handle to a local_counted object. It
+    // converts implicitly from a shared_ptr, so a constructor taking
+    // local_ptr<A> can be registered with a dependency on A. A
+    // local_ptr may point at any base of the object. It and its
+    // copies must stay on one thread.
+    template<typename T>
+        class local_ptr
+        {
+            private:
+                template<typename U>
+                    friend class local_ptr;
 
-            registration_types types;
+                T *object;
+                const local_counted *counted;
 
-            std::shared_ptr<container> self;
+                void attach() const
+                {
+                    if( counted )
+                    {
+                        counted->local_references++;
+                    }
+                }
 
-            static inline void destroy_factory( ifactory *factory )
-            {
-                if( factory )
+            public:
+                local_ptr() : object( NULL ), counted( NULL )
                 {
-                    delete factory;
-                    factory = NULL;
                 }
-            }
 
-            // Registration helper
-            template<typename F, typename I, typename ...argtypes>
-                void register_with_name_template( const std::string &name_in,
-                        argtypes... args )
+                local_ptr( std::shared_ptr<T> shared ) 
+                    : object( shared.get() ), counted( shared.get() )
                 {
-                    if( type_is_registered<I>( name_in ) )
+                    if( counted && counted->local_references++ == 0 )
                     {
-                        // Throw an exception as we cannot register a type
-                        // which has already been registered
-                        throw registration_exception( typeid(I).name(), 
-                                name_in );
+                        counted->owner = std::move( shared );
                     }
-                    F *new_factory = new F( name_in, args... );
-                    types[std::type_index(typeid(I))][name_in] = new_factory;
                 }
-            
-            // Resolve factory for interface. If that fails then return NULL.
-            template<typename I>
-                const ifactory *resolve_factory() const
+
+                local_ptr( const local_ptr &other ) 
+                    : object( other.object ), counted( other.counted )
                 {
-                    // Lookup interface type. If it cannot be found return
-                    // the default for that type.
-                    ifactory *result = NULL;
-                    registration_types::const_iterator i = types.find(std::type_index(typeid(I)));
-                    if( i != types.end() )
+                    attach();
+                }
+
+                template<typename U>
+                    local_ptr( const local_ptr<U> &other ) 
+                    : object( other.object ), counted( other.counted )
                     {
-                        const named_factory candidates =
-                            i->second;
-                        result = (candidates.begin())->second;
+                        attach();
                     }
-                    return result;
+
+                local_ptr( local_ptr &&other ) 
+                    : object( other.object ), counted( other.counted )
+                {
+                    other.object = NULL;
+                    other.counted = NULL;
                 }
 
-            // Resolve factory for interface type by name. 
-            // If that fails then return NULL.
-            template<typename I>
-                ifactory *
-                resolve_factory_by_name( const std::string &name_in ) const
+                ~local_ptr()
                 {
-                    // Lookup interface type. If it cannot be found return
-                    // the default for that type.
-                    ifactory *result = NULL;
-                    registration_types::const_iterator i = types.find(std::type_index(typeid(I)));
-                    if( i != types.end() )
+                    reset();
+                }
+
+                local_ptr &operator=( local_ptr other )
+                {
+                    std::swap( object, other.object );
+                    std::swap( counted, other.counted );
+                    return *this;
+                }
+
+                void reset()
+                {
+                    if( counted )
                     {
-                        // We've got the type registered but we now need to look
-                        // up the named version.
-                        const named_factory::const_iterator c = 
-                            i->second.find(name_in);
-                        if( c != i->second.end() )
+                        const local_counted *last_counted = counted;
+                        object = NULL;
+                        counted = NULL;
+                        if( --last_counted->local_references == 0 )
                         {
-                            result = c->second;
+                            // Releasing the owner may destroy the object
+                            std::shared_ptr<const void> last;
+                            last.swap( last_counted->owner );
                         }
                     }
-                    return result;
                 }
-            
-            
 
+                T *get() const
+                {
+                    return object;
+                }
+
+                T &operator*() const
+                {
+                    return *object;
+                }
+
+                T *operator->() const
+                {
+                    return object;
+                }
+
+                explicit operator bool() const
+                {
+                    return object != NULL;
+                }
+
+                // Number of local_ptrs sharing the object
+                size_t use_count() const
+                {
+                    return counted ? counted->local_references : 0;
+                }
+        };
+
+    // flat_table is an open-addressing hash table using linear
+    // probing. Each slot holds the cached hash, the key and the
+    // value next to each other in a single contiguous array so
+    // a lookup usually touches one cache line and never chases
+    // tree pointers. Erasure uses backward shift deletion so no
+    // tombstones are left behind. Keys and values must be
+    // default constructible. Lookups accept any key type which
+    // H and E accept, so a table can be searched without first
+    // converting to K. Slots are allocated through A.
+    template<typename K, typename V,
+        typename H = std::hash<K>, typename E = std::equal_to<K>,
+        typename A = std::allocator<K>>
+        class flat_table
+    {
         public:
-            container() : self(this, container_deleter())
+            struct slot
             {
-                // Register our special shared_ptr which will not
-                // delete if a container is resolved.
-                this->register_instance<container>(self);
-            }
+                size_t hash;
+                bool used;
+                K key;
+                V value;
 
-            ~container()
-            {
-                // Destroy all factories
-                for( registration_types::reverse_iterator i = types.rbegin();
-                        i != types.rend(); ++i )
+                slot() : hash( 0 ), used( false ), key(), value()
                 {
-                    for(named_factory::reverse_iterator j = i->second.rbegin(); 
-                            j != i->second.rend(); ++j)
+                }
+            };
+
+            // Forward iterator over occupied slots only.
+            template<typename slot_type>
+                class basic_iterator
+            {
+                private:
+                    slot_type *current;
+                    slot_type *last;
+
+                    void skip_empty()
                     {
-                        destroy_factory( j->second );
+                        while( current != last && !current->used )
+                        {
+                            ++current;
+                        }
+                    }
+
+                public:
+                    basic_iterator( slot_type *current_in, slot_type *last_in )
+                        : current( current_in ), last( last_in )
+                    {
+                        skip_empty();
+                    }
+
+                    slot_type &operator*() const
+                    {
+                        return *current;
+                    }
+
+                    slot_type *operator->() const
+                    {
+                        return current;
+                    }
+
+                    basic_iterator &operator++()
+                    {
+                        ++current;
+                        skip_empty();
+                        return *this;
+                    }
+
+                    bool operator==( const basic_iterator &other ) const
+                    {
+                        return current == other.current;
+                    }
+
+                    bool operator!=( const basic_iterator &other ) const
+                    {
+                        return current != other.current;
+                    }
+            };
+
+            typedef basic_iterator<slot> iterator;
+            typedef basic_iterator<const slot> const_iterator;
+
+        private:
+            static const size_t min_capacity = 4;
+
+            typedef typename std::allocator_traits<A>::template 
+                rebind_alloc<slot> slot_allocator;
+            typedef std::vector<slot, slot_allocator> slot_vector;
+
+            slot_vector slots;
+            size_t count;
+            H hasher;
+            E equal;
+
+            // Locate the slot holding key or, if it is not present,
+            // the empty slot where it would be inserted.
+            template<typename L>
+                size_t probe( const L &key, size_t hash ) const
+            {
+                const size_t mask = slots.size() - 1;
+                size_t i = hash & mask;
+                while( slots[i].used &&
+                        !( slots[i].hash == hash && equal( slots[i].key, key ) ) )
+                {
+                    i = ( i + 1 ) & mask;
+                }
+                return i;
+            }
+
+            void rehash( size_t capacity )
+            {
+                slot_vector old( capacity, slot(), slots.get_allocator() );
+                old.swap( slots );
+                const size_t mask = capacity - 1;
+                for( typename slot_vector::iterator i = old.begin();
+                        i != old.end(); ++i )
+                {
+                    if( i->used )
+                    {
+                        size_t j = i->hash & mask;
+                        while( slots[j].used )
+                        {
+                            j = ( j + 1 ) & mask;
+                        }
+                        slots[j] = std::move( *i );
+                    }
+                }
+            }
+
+        public:
+            explicit flat_table( const A &allocator_in = A() ) 
+                : slots( slot_allocator( allocator_in ) ), count( 0 ), hasher(), equal()
+            {
+            }
+
+            size_t size() const
+            {
+                return count;
+            }
+
+            bool empty() const
+            {
+                return count == 0;
+            }
+
+            iterator begin()
+            {
+                return iterator( slots.data(), slots.data() + slots.size() );
+            }
+
+            iterator end()
+            {
+                return iterator( slots.data() + slots.size(),
+                        slots.data() + slots.size() );
+            }
+
+            const_iterator begin() const
+            {
+                return const_iterator( slots.data(), slots.data() + slots.size() );
+            }
+
+            const_iterator end() const
+            {
+                return const_iterator( slots.data() + slots.size(),
+                        slots.data() + slots.size() );
+            }
+
+            // Return a pointer to the value stored against key
+            // or NULL if key is not present.
+            template<typename L>
+                V *find( const L &key )
+            {
+                return const_cast<V *>(
+                        static_cast<const flat_table *>( this )->find( key ) );
+            }
+
+            template<typename L>
+                const V *find( const L &key ) const
+            {
+                const V *result = NULL;
+                if( count != 0 )
+                {
+                    const slot &s = slots[probe( key, hasher( key ) )];
+                    if( s.used )
+                    {
+                        result = &s.value;
+                    }
+                }
+                return result;
+            }
+
+            // Return the value stored against key, inserting a
+            // default constructed value if key is not present.
+            V &operator[]( const K &key )
+            {
+                // Keep the load factor at or below 3/4.
+                if( ( count + 1 ) * 4 > slots.size() * 3 )
+                {
+                    rehash( slots.empty() ? min_capacity : slots.size() * 2 );
+                }
+                const size_t hash = hasher( key );
+                slot &s = slots[probe( key, hash )];
+                if( !s.used )
+                {
+                    s.hash = hash;
+                    s.used = true;
+                    s.key = key;
+                    ++count;
+                }
+                return s.value;
+            }
+
+            template<typename L>
+                bool erase( const L &key )
+            {
+                bool result = false;
+                if( count != 0 )
+                {
+                    const size_t mask = slots.size() - 1;
+                    size_t i = probe( key, hasher( key ) );
+                    if( slots[i].used )
+                    {
+                        // Shift back any following slot whose home
+                        // position means it can no longer be found
+                        // once slot i becomes empty.
+                        size_t j = i;
+                        for( ;; )
+                        {
+                            j = ( j + 1 ) & mask;
+                            if( !slots[j].used )
+                            {
+                                break;
+                            }
+                            const size_t home = slots[j].hash & mask;
+                            const bool movable = ( i <= j ) ?
+                                ( home <= i || home > j ) :
+                                ( home <= i && home > j );
+                            if( movable )
+                            {
+                                slots[i] = std::move( slots[j] );
+                                i = j;
+                            }
+                        }
+                        slots[i] = slot();
+                        --count;
+                        result = true;
+                    }
+                }
+                return result;
+            }
+
+            void clear()
+            {
+                slots.clear();
+                count = 0;
+            }
+    };
+
+    class construction_program;
+
+    // ifactory is the base interface for a factory 
+    // type. create_item<I> returns a shared_ptr to the interface
+    // the factory was registered for, which must be I. The item
+    // is moved out, never cast from shared_ptr<void>, so no
+    // reference count is touched on the way.
+    // create_item is not virtual. Each factory stores the
+    // function which creates its items next to its vtable
+    // pointer, so resolution makes a single indirect call.
+    // compile appends the steps which construct an item to
+    // a construction_program. By default that is a single
+    // step calling create_item.
+    class ifactory 
+    {
+        public:
+            // Stores the item in the std::shared_ptr<I> at result
+            typedef void (*create_function)( const ifactory *, void *result );
+
+        private:
+            const create_function create;
+
+        protected:
+            explicit ifactory( create_function create_in ) : create( create_in )
+            {
+            }
+
+        public:
+            virtual ~ifactory(){}
+            virtual const std::type_info &get_type() const = 0;
+            virtual const std::string &get_name() const = 0;
+            virtual void compile( construction_program &program ) const = 0;
+
+            // The object the factory keeps alive itself, if any, which
+            // can be lent out without touching its reference count.
+            virtual void *borrow_item() const
+            {
+                return NULL;
+            }
+
+            template<typename I>
+                std::shared_ptr<I> create_item() const
+                {
+                    std::shared_ptr<I> result;
+                    create( this, &result );
+                    return result;
+                }
+    };
+
+    // BaseFatory extends ifactory to provide some standard
+    // functionality that is required by most concrete
+    // factoy types.
+    template<typename I>
+        class base_factory : public ifactory
+    {
+        private:
+            std::string name;
+
+        protected:
+            // The create_function for a factory of type F, which
+            // must befriend base_factory<I>.
+            template<typename F>
+                static void create_with( const ifactory *factory, void *result )
+                {
+                    *static_cast<std::shared_ptr<I> *>( result ) = 
+                        static_cast<const F *>( factory )->internal_create_item();
+                }
+
+        public:
+
+            base_factory( const std::string &name_in, create_function create_in ) 
+                : ifactory( create_in ), name( name_in )
+            {
+            }
+
+            ~base_factory()
+            {
+            }
+
+            const std::type_info &get_type() const
+            {
+                return typeid(I);
+            }
+
+            const std::string &get_name() const
+            {
+                return name;
+            }
+
+            void compile( construction_program &program ) const;
+    };
+
+    // Compile time list of argument indices used to expand
+    // a pack of dependencies alongside their position.
+    template<size_t ...indices>
+        struct index_list
+        {
+        };
+
+    template<size_t n, size_t ...indices>
+        struct make_index_list : make_index_list<n - 1, n - 1, indices...>
+        {
+        };
+
+    template<size_t ...indices>
+        struct make_index_list<0, indices...>
+        {
+            typedef index_list<indices...> type;
+        };
+
+    // program_item is one value on a construction_program stack:
+    // a shared_ptr to the interface type of the step that produced
+    // it, or nothing. Items are moved in and out with their type,
+    // so handing one from a step to the next, and on into a
+    // constructor, costs no reference count operations.
+    class program_item
+    {
+        private:
+            typedef std::aligned_storage<sizeof( std::shared_ptr<void> ),
+                    alignof( std::shared_ptr<void> )>::type storage_type;
+
+            storage_type storage;
+            // Copies the item into copy_in, or destroys it if NULL
+            void (*manage)( storage_type &, program_item *copy_in );
+
+            program_item( const program_item & );
+            program_item &operator=( const program_item & );
+
+            template<typename A>
+                static void manage_as( storage_type &storage_in, program_item *copy_in )
+                {
+                    typedef std::shared_ptr<A> pointer_type;
+                    pointer_type &value = *reinterpret_cast<pointer_type *>( &storage_in );
+                    if( copy_in )
+                    {
+                        copy_in->put( pointer_type( value ) );
+                    }
+                    else
+                    {
+                        value.~pointer_type();
+                    }
+                }
+
+        public:
+            program_item() : manage( NULL )
+            {
+            }
+
+            ~program_item()
+            {
+                reset();
+            }
+
+            void reset()
+            {
+                if( manage )
+                {
+                    manage( storage, NULL );
+                    manage = NULL;
+                }
+            }
+
+            // Make other share the item, or empty if there is none
+            void copy_to( program_item &other )
+            {
+                if( manage )
+                {
+                    manage( storage, &other );
+                }
+                else
+                {
+                    other.reset();
+                }
+            }
+
+            template<typename A>
+                void put( std::shared_ptr<A> &&value )
+                {
+                    static_assert( sizeof( std::shared_ptr<A> ) <= sizeof( storage_type ) &&
+                            alignof( std::shared_ptr<A> ) <= alignof( storage_type ),
+                            "shared_ptr does not fit a program_item" );
+                    reset();
+                    new( &storage ) std::shared_ptr<A>( std::move( value ) );
+                    manage = &manage_as<A>;
+                }
+
+            // Move the item out. It must have been put as A.
+            template<typename A>
+                std::shared_ptr<A> take()
+                {
+                    std::shared_ptr<A> result;
+                    if( manage )
+                    {
+                        result.swap( *reinterpret_cast<std::shared_ptr<A> *>( &storage ) );
+                        reset();
+                    }
+                    return result;
+                }
+    };
+
+    // construction_program is a dependency graph flattened into
+    // a list of steps in post-order. Each step takes its arguments
+    // from the top of a small value stack, constructs an item from
+    // them and leaves it in place of the first argument, so running
+    // a program is a single loop with no registry lookups. Factories
+    // which construct directly from their dependencies inline their
+    // own steps; any other factory is a single step calling
+    // create_item.
+    // A program may have several roots, each leaving its item on the
+    // stack, and may share registrations: a registration reached a
+    // second time reuses the item of its first step rather than
+    // compiling its steps again.
+    class construction_program
+    {
+        public:
+            // A step must take every one of its arguments before
+            // putting its own item in args[0].
+            typedef void (*step_function)( const ifactory *, program_item *args );
+
+        private:
+            static const size_t inline_depth = 16;
+            static const size_t no_slot = static_cast<size_t>( -1 );
+
+            // A step without a function pushes the item kept in slot.
+            // A step with a slot keeps a copy of its item there.
+            struct step
+            {
+                step_function run;
+                const ifactory *factory;
+                size_t arity;
+                size_t slot;
+            };
+
+            // The last step compiled for a shared factory
+            struct compiled_factory
+            {
+                const ifactory *factory;
+                size_t last_step;
+            };
+
+            const size_t generation;
+            std::vector<step> steps;
+            size_t depth;
+            size_t max_depth;
+            size_t kept;
+            bool shared_items;
+            bool shared_registrations;
+            std::vector<compiled_factory> compiled;
+
+            construction_program( const construction_program & );
+            construction_program &operator=( const construction_program & );
+
+            template<typename I>
+                static void create_item_step( const ifactory *factory, program_item *args )
+                {
+                    args[0].put( factory->create_item<I>() );
+                }
+
+            // Unregistered dependencies are left empty
+            static void null_step( const ifactory *, program_item * )
+            {
+            }
+
+            // The value stack takes the first max_depth items of stack
+            // and kept items the rest. If a step throws, the stack
+            // releases every item constructed so far.
+            void execute( program_item *stack ) const
+            {
+                program_item *const slots = stack + max_depth;
+                size_t top = 0;
+                for( std::vector<step>::const_iterator i = steps.begin();
+                        i != steps.end(); ++i )
+                {
+                    if( i->run )
+                    {
+                        const size_t base = top - i->arity;
+                        i->run( i->factory, stack + base );
+                        top = base + 1;
+                        if( i->slot != no_slot )
+                        {
+                            stack[base].copy_to( slots[i->slot] );
+                        }
+                    }
+                    else
+                    {
+                        slots[i->slot].copy_to( stack[top] );
+                        top++;
+                    }
+                }
+            }
+
+            template<typename I>
+                static std::shared_ptr<I> take_root( program_item *stack )
+                {
+                    return stack[0].take<I>();
+                }
+
+            template<typename tuple_type, size_t ...indices>
+                static tuple_type take_indexed( program_item *stack, index_list<indices...> )
+                {
+                    return tuple_type( stack[indices].template take<
+                            typename std::tuple_element<indices, tuple_type>::type::element_type>()... );
+                }
+
+            template<typename tuple_type>
+                static tuple_type take_roots( program_item *stack )
+                {
+                    return take_indexed<tuple_type>( stack, 
+                            typename make_index_list<std::tuple_size<tuple_type>::value>::type() );
+                }
+
+            template<typename result_type>
+                result_type run_with( result_type (*take)( program_item * ) ) const
+                {
+                    result_type result;
+                    if( max_depth + kept <= inline_depth )
+                    {
+                        program_item stack[inline_depth];
+                        execute( stack );
+                        result = take( stack );
+                    }
+                    else
+                    {
+                        std::unique_ptr<program_item[]> stack( 
+                                new program_item[max_depth + kept] );
+                        execute( stack.get() );
+                        result = take( stack.get() );
+                    }
+                    return result;
+                }
+
+            // Append the steps of factory, or a step reusing its item
+            // if they have already been appended.
+            void append_shared( const ifactory *factory )
+            {
+                std::vector<compiled_factory>::const_iterator i = compiled.begin();
+                while( i != compiled.end() && i->factory != factory )
+                {
+                    ++i;
+                }
+                if( i != compiled.end() )
+                {
+                    step &first = steps[i->last_step];
+                    if( first.slot == no_slot )
+                    {
+                        first.slot = kept++;
+                    }
+                    const step s = { NULL, factory, 0, first.slot };
+                    steps.push_back( s );
+                    depth++;
+                    max_depth = std::max( max_depth, depth );
+                }
+                else
+                {
+                    factory->compile( *this );
+                    const compiled_factory c = { factory, steps.size() - 1 };
+                    compiled.push_back( c );
+                }
+            }
+
+        public:
+            explicit construction_program( size_t generation_in ) 
+                : generation( generation_in ), steps(), depth( 0 ), max_depth( 0 ),
+                kept( 0 ), shared_items( false ), shared_registrations( false ),
+                compiled()
+            {
+            }
+
+            // The container generation the program was compiled against
+            size_t get_generation() const
+            {
+                return generation;
+            }
+
+            // Append a step which consumes the arity items on top
+            // of the stack.
+            void append_step( step_function run, const ifactory *factory, 
+                    size_t arity )
+            {
+                const step s = { run, factory, arity, no_slot };
+                steps.push_back( s );
+                depth = depth - arity + 1;
+                max_depth = std::max( max_depth, depth );
+            }
+
+            // Mark the program as containing per-graph items, which
+            // must be shared in a resolution_context while it runs.
+            void share_items()
+            {
+                shared_items = true;
+            }
+
+            bool shares_items() const
+            {
+                return shared_items;
+            }
+
+            // Construct each registration at most once while the
+            // program runs. Must be called before any step is appended.
+            void share_registrations()
+            {
+                shared_registrations = true;
+            }
+
+            // Append a step calling create_item on a factory
+            // registered for I.
+            template<typename I>
+                void append_item( const ifactory *factory )
+                {
+                    append_step( create_item_step<I>, factory, 0 );
+                }
+
+            // Append the steps which resolve A. An unregistered
+            // dependency resolves to NULL.
+            template<typename A, typename resolver_type>
+                void append_dependency( const resolver_type &resolver )
+                {
+                    const ifactory *factory = resolver.template resolve_factory<A>();
+                    if( !factory )
+                    {
+                        append_step( null_step, NULL, 0 );
+                    }
+                    else if( shared_registrations )
+                    {
+                        append_shared( factory );
+                    }
+                    else
+                    {
+                        factory->compile( *this );
+                    }
+                }
+
+            // Run the program of a factory registered for I
+            template<typename I>
+                std::shared_ptr<I> run() const
+                {
+                    return run_with<std::shared_ptr<I>>( &take_root<I> );
+                }
+
+            // Run a program with a root for each of interfaces, in order
+            template<typename ...interfaces>
+                std::tuple<std::shared_ptr<interfaces>...> run_all() const
+                {
+                    typedef std::tuple<std::shared_ptr<interfaces>...> tuple_type;
+                    return run_with<tuple_type>( &take_roots<tuple_type> );
+                }
+    };
+
+    template<typename I>
+        void base_factory<I>::compile( construction_program &program ) const
+        {
+            program.append_item<I>( this );
+        }
+
+    // resolution_context is active on a thread while a graph
+    // containing per-graph registrations is resolved. Items of
+    // per-graph registrations are kept in it and shared by every
+    // dependency resolved meanwhile. A resolution started through the
+    // container's public interface, for example from a delegate, is
+    // a new graph and starts outside it.
+    class resolution_context
+    {
+        private:
+            static const size_t inline_items = 16;
+
+            struct item
+            {
+                const ifactory *factory;
+                std::shared_ptr<void> value;
+            };
+
+            const container &owner;
+            const resolution_context *const previous;
+            // The first items are constructed in place here as they
+            // are added, any more go to overflow.
+            mutable std::aligned_storage<sizeof( item ), 
+                    alignof( item )>::type items[inline_items];
+            mutable size_t count;
+            mutable std::vector<item> overflow;
+
+            item *find( const ifactory *factory ) const
+            {
+                item *result = NULL;
+                for( size_t i = 0; i < count && !result; i++ )
+                {
+                    item &candidate = i < inline_items ? 
+                        *reinterpret_cast<item *>( &items[i] ) : overflow[i - inline_items];
+                    if( candidate.factory == factory )
+                    {
+                        result = &candidate;
+                    }
+                }
+                return result;
+            }
+
+            resolution_context( const resolution_context & );
+            resolution_context &operator=( const resolution_context & );
+
+            static const resolution_context *&active()
+            {
+                static thread_local const resolution_context *context = NULL;
+                return context;
+            }
+
+        public:
+            // Hides the active context for its lifetime
+            class isolation
+            {
+                private:
+                    const resolution_context *const hidden;
+
+                    isolation( const isolation & );
+                    isolation &operator=( const isolation & );
+
+                public:
+                    isolation() : hidden( active() )
+                    {
+                        if( hidden )
+                        {
+                            active() = NULL;
+                        }
+                    }
+
+                    ~isolation()
+                    {
+                        if( hidden )
+                        {
+                            active() = hidden;
+                        }
+                    }
+            };
+
+            explicit resolution_context( const container &owner_in ) 
+                : owner( owner_in ), previous( active() ), count( 0 ), overflow()
+            {
+                active() = this;
+            }
+
+            ~resolution_context()
+            {
+                active() = previous;
+                for( size_t i = 0; i < count && i < inline_items; i++ )
+                {
+                    reinterpret_cast<item *>( &items[i] )->~item();
+                }
+            }
+
+            // The context active for owner_in on this thread, or NULL
+            static const resolution_context *current( const container &owner_in )
+            {
+                const resolution_context *result = active();
+                return result && &result->owner == &owner_in ? result : NULL;
+            }
+
+            // The item factory has already constructed in this context,
+            // otherwise a new one from create which is then kept.
+            template<typename I, typename creator_type>
+                std::shared_ptr<I> share( const ifactory *factory, 
+                        creator_type &create ) const
+                {
+                    std::shared_ptr<I> result;
+                    const item *found = find( factory );
+                    if( found )
+                    {
+                        result = std::static_pointer_cast<I>( found->value );
+                    }
+                    else
+                    {
+                        result = create();
+                        const item created = { factory, result };
+                        if( count < inline_items )
+                        {
+                            new( &items[count] ) item( created );
+                        }
+                        else
+                        {
+                            overflow.push_back( created );
+                        }
+                        count++;
+                    }
+                    return result;
+                }
+    };
+
+    // program_cache holds the construction_program for a factory,
+    // or for a batch of interfaces, stamped with the container
+    // generation it was compiled against. The program is recompiled
+    // when any registration changes. Replaced programs are retired
+    // to the container, which frees them once no reader can still
+    // be running them.
+    class program_cache
+    {
+        private:
+            mutable std::atomic<const construction_program *> current;
+            mutable std::mutex rebuild_lock;
+
+            program_cache( const program_cache & );
+            program_cache &operator=( const program_cache & );
+
+            // The program for the latest generation, compiled with
+            // compile if the current one is out of date.
+            template<typename resolver_type, typename compiler_type>
+                const construction_program *latest_program( resolver_type &resolver, 
+                        const compiler_type &compile ) const
+                {
+                    const construction_program *program = 
+                        current.load( std::memory_order_acquire );
+                    if( !program || program->get_generation() != resolver.get_generation() )
+                    {
+                        std::lock_guard<std::mutex> guard( rebuild_lock );
+                        // The generation is read before compiling so a
+                        // program is never stamped newer than its steps.
+                        const size_t latest = resolver.get_generation();
+                        program = current.load( std::memory_order_relaxed );
+                        if( !program || program->get_generation() != latest )
+                        {
+                            std::unique_ptr<construction_program> built( 
+                                    new construction_program( latest ) );
+                            compile( *built );
+                            const construction_program *old = program;
+                            program = built.release();
+                            current.store( program, std::memory_order_release );
+                            if( old )
+                            {
+                                resolver.retire_program( old );
+                            }
+                        }
+                    }
+                    return program;
+                }
+
+        public:
+            program_cache() : current( NULL ), rebuild_lock()
+            {
+            }
+
+            ~program_cache()
+            {
+                delete current.load();
+            }
+
+            template<typename I, typename resolver_type>
+                std::shared_ptr<I> run( resolver_type &resolver, 
+                        const ifactory &root ) const
+                {
+                    const construction_program *program = latest_program( resolver, 
+                            [&root]( construction_program &program_in ) 
+                            { 
+                                root.compile( program_in ); 
+                            } );
+                    std::shared_ptr<I> result;
+                    if( program->shares_items() && !resolution_context::current( resolver ) )
+                    {
+                        // The outermost program opens the context
+                        // for the whole graph.
+                        resolution_context context( resolver );
+                        result = program->run<I>();
+                    }
+                    else
+                    {
+                        result = program->run<I>();
+                    }
+                    return result;
+                }
+
+            // Run a program with a root for each of interfaces which
+            // constructs each registration at most once.
+            template<typename ...interfaces, typename resolver_type>
+                std::tuple<std::shared_ptr<interfaces>...> run_all( 
+                        resolver_type &resolver ) const
+                {
+                    const construction_program *program = latest_program( resolver, 
+                            [&resolver]( construction_program &program_in ) 
+                            { 
+                                program_in.share_registrations();
+                                int expand[] = { 0, ( program_in.template 
+                                        append_dependency<interfaces>( resolver ), 0 )... };
+                                (void)expand;
+                            } );
+                    std::tuple<std::shared_ptr<interfaces>...> result;
+                    if( program->shares_items() )
+                    {
+                        resolution_context context( resolver );
+                        result = program->run_all<interfaces...>();
+                    }
+                    else
+                    {
+                        result = program->run_all<interfaces...>();
+                    }
+                    return result;
+                }
+    };
+
+    // dependency_plan caches the factory which resolves each
+    // constructor dependency of a factory. The plan is stamped with
+    // the container generation it was built against and is rebuilt
+    // when any registration changes, so resolving a dependency graph
+    // walks factory pointers instead of repeating registry lookups at
+    // every node. Only a rebuild takes a lock.
+    template<typename ...argtypes>
+        class dependency_plan
+        {
+            private:
+                static const size_t count = sizeof...(argtypes);
+                typedef typename make_index_list<count>::type indices_type;
+
+                mutable std::atomic<const ifactory *> factories[count ? count : 1];
+                mutable std::atomic<size_t> generation;
+                mutable std::mutex rebuild_lock;
+
+                dependency_plan( const dependency_plan & );
+                dependency_plan &operator=( const dependency_plan & );
+
+                template<typename resolver_type, size_t ...indices>
+                    void rebuild( const resolver_type &resolver, 
+                            index_list<indices...> ) const
+                    {
+                        // Released so a reader of the slot also sees the
+                        // construction of the factory it points to.
+                        int expand[] = { 0, ( factories[indices].store(
+                                    resolver.template resolve_factory<argtypes>(),
+                                    std::memory_order_release ), 0 )... };
+                        (void)expand;
+                    }
+
+                template<typename A>
+                    static std::shared_ptr<A> create( const ifactory *factory )
+                    {
+                        std::shared_ptr<A> result;
+                        if( factory )
+                        {
+                            result = factory->create_item<A>();
+                        }
+                        return result;
+                    }
+
+                template<typename result_type, typename resolver_type, 
+                    typename callable_type, size_t ...indices>
+                    result_type invoke( const resolver_type &resolver, 
+                            callable_type &callable, index_list<indices...> ) const
+                    {
+                        // A plan without dependencies has nothing to rebuild.
+                        const size_t current = count ? resolver.get_generation() : 0;
+                        if( count && generation.load( std::memory_order_acquire ) != current )
+                        {
+                            std::lock_guard<std::mutex> guard( rebuild_lock );
+                            // The generation is read before the lookups so a
+                            // plan is never stamped newer than its factories.
+                            const size_t latest = resolver.get_generation();
+                            if( generation.load( std::memory_order_relaxed ) != latest )
+                            {
+                                rebuild( resolver, indices_type() );
+                                generation.store( latest, std::memory_order_release );
+                            }
+                        }
+                        // A slot may be written by a rebuild for a newer
+                        // generation while it is read, so it is acquired
+                        // on its own rather than through the generation.
+                        return callable( create<argtypes>( 
+                                    factories[indices].load( std::memory_order_acquire ) )... );
+                    }
+
+            public:
+                dependency_plan() : generation( static_cast<size_t>( -1 ) ), rebuild_lock()
+                {
+                    for( size_t i = 0; i < ( count ? count : 1 ); i++ )
+                    {
+                        factories[i].store( NULL, std::memory_order_relaxed );
+                    }
+                }
+
+                // Resolve every dependency and pass them to callable.
+                // If there is an error during resolution any already
+                // resolved objects are released. The dependencies form
+                // one graph, so outside of a resolution_context one is
+                // opened for any per-graph registrations among them.
+                template<typename result_type, typename resolver_type, 
+                    typename callable_type>
+                    result_type resolve( const resolver_type &resolver, 
+                            callable_type &callable ) const
+                    {
+                        result_type result;
+                        if( count && !resolution_context::current( resolver ) )
+                        {
+                            resolution_context graph( resolver );
+                            result = invoke<result_type>( resolver, callable, indices_type() );
+                        }
+                        else
+                        {
+                            result = invoke<result_type>( resolver, callable, indices_type() );
+                        }
+                        return result;
+                    }
+        };
+
+    // DelegateFactory allows delegate objects or routines to be
+    // supplied and called for object construction. All delegate
+    // arguments are resolved by the resolver before being send
+    // to the delegate instance.
+    template<typename I, typename callable, typename ...argtypes>
+        class delegate_factory : public base_factory<I>
+    {
+        private:
+            typedef typename make_index_list<sizeof...(argtypes)>::type indices_type;
+
+            ioc::container &container_obj;
+            mutable callable callable_obj;
+            program_cache program;
+
+            template<size_t ...indices>
+                I *invoke( program_item *args, index_list<indices...> ) const
+                {
+                    return callable_obj( args[indices].template take<argtypes>()... );
+                }
+
+            static void construct( const ifactory *factory, program_item *args )
+            {
+                const delegate_factory *self = 
+                    static_cast<const delegate_factory *>( factory );
+                args[0].put( std::shared_ptr<I>( self->invoke( args, indices_type() ) ) );
+            }
+
+            friend class base_factory<I>;
+
+            std::shared_ptr<I> internal_create_item() const
+            {
+                // Resolve all variables for construction.
+                // If there is an error during resolution
+                // then the program will de-allocate any
+                // already resolved objects for us.
+                std::shared_ptr<I> result;
+                if( sizeof...(argtypes) == 0 )
+                {
+                    result = std::shared_ptr<I>( invoke( NULL, indices_type() ) );
+                }
+                else
+                {
+                    result = program.run<I>( container_obj, *this );
+                }
+                return result;
+            }
+
+        public:
+            delegate_factory( const std::string &name_in, 
+                    ioc::container &container_in, const 
+                    callable &callable_obj_in )
+                : base_factory<I>( name_in, 
+                        &base_factory<I>::template create_with<delegate_factory> ), 
+                container_obj( container_in ), 
+                callable_obj( callable_obj_in ), program()
+        {
+        }
+
+            ~delegate_factory()
+            {
+            }
+
+            void compile( construction_program &program_in ) const
+            {
+                int expand[] = { 0, ( program_in.template 
+                        append_dependency<argtypes>( container_obj ), 0 )... };
+                (void)expand;
+                program_in.append_step( construct, this, sizeof...(argtypes) );
+            }
+
+    };
+
+    // ResolvableFactory resolves the constructor arguments of
+    // a specific type and instantiates it. The object and its
+    // shared_ptr control block are created in a single
+    // allocation.
+    template<typename I, typename T, typename ...argtypes>
+        class resolvable_factory 
+        : public base_factory<I>
+    {
+        public:
+            typedef std::shared_ptr<I> (func_type)(std::shared_ptr<argtypes>...);
+
+        private:
+            typedef typename make_index_list<sizeof...(argtypes)>::type indices_type;
+
+            ioc::container &container_obj;
+            program_cache program;
+            // Resource products are allocated from, or NULL
+            // to use make_shared.
+            memory_resource *const products;
+
+            template<size_t ...indices>
+                static std::shared_ptr<I> create( memory_resource *products_in, 
+                        program_item *args, index_list<indices...> )
+                {
+                    std::shared_ptr<I> result;
+                    if( products_in )
+                    {
+                        result = std::allocate_shared<T>( 
+                                resource_allocator<T>( *products_in ),
+                                args[indices].template take<argtypes>()... );
+                    }
+                    else
+                    {
+                        result = std::make_shared<T>( 
+                                args[indices].template take<argtypes>()... );
+                    }
+                    return result;
+                }
+
+            static void construct( const ifactory *self, program_item *args )
+            {
+                args[0].put( create( static_cast<const resolvable_factory *>( self )->products, 
+                            args, indices_type() ) );
+            }
+
+            friend class base_factory<I>;
+
+            std::shared_ptr<I> internal_create_item() const
+            {
+                std::shared_ptr<I> result;
+                if( sizeof...(argtypes) == 0 )
+                {
+                    result = create( products, NULL, indices_type() );
+                }
+                else
+                {
+                    result = program.run<I>( container_obj, *this );
+                }
+                return result;
+            }
+
+        public:
+            resolvable_factory( 
+                    const std::string &name_in, 
+                    ioc::container &container_in,
+                    memory_resource *products_in = NULL )
+                : base_factory<I>( name_in, 
+                        &base_factory<I>::template create_with<resolvable_factory> ), 
+                container_obj( container_in ), program(), products( products_in )
+        {
+        }
+
+            ~resolvable_factory()
+            {
+            }
+
+            void compile( construction_program &program_in ) const
+            {
+                int expand[] = { 0, ( program_in.template 
+                        append_dependency<argtypes>( container_obj ), 0 )... };
+                (void)expand;
+                program_in.append_step( construct, this, sizeof...(argtypes) );
+            }
+    };
+
+    // isntance_factory stores an instance of the required type.
+    // create_item simply returns a copy of the stored instance.
+    template<typename I>
+        class instance_factory
+        : public base_factory<I>
+        {
+            private: 
+                std::shared_ptr<I> instance;
+
+                friend class base_factory<I>;
+
+                std::shared_ptr<I> internal_create_item() const
+                {
+                    return instance;
+                }
+
+                void *borrow_item() const
+                {
+                    return instance.get();
+                }
+
+            public:
+                instance_factory( const std::string &name_in, std::shared_ptr<I> instance_in )
+                    : base_factory<I>( name_in, 
+                            &base_factory<I>::template create_with<instance_factory> ), 
+                    instance( instance_in )
+                {
+                }
+
+                ~instance_factory()
+                {
+                }
+        };
+
+    // singleton_factory constructs a single instance of T the first
+    // time it is resolved and hands out that same instance from then
+    // on. Construction is guarded by a mutex and happens exactly once.
+    // Once built the instance is published through an atomic pointer
+    // so later resolutions take no lock.
+    template<typename I, typename T, typename ...argtypes>
+        class singleton_factory
+        : public base_factory<I>
+        {
+            private:
+                typedef std::shared_ptr<I> (*creator_type)( std::shared_ptr<argtypes>... );
+
+                ioc::container &container_obj;
+                dependency_plan<argtypes...> plan;
+                mutable std::atomic<std::shared_ptr<I> *> instance;
+                mutable std::mutex construction_lock;
+
+                static std::shared_ptr<I> creator( std::shared_ptr<argtypes>... args )
+                {
+                    return std::make_shared<T>( std::move( args )... );
+                }
+
+                const std::shared_ptr<I> &get_instance() const
+                {
+                    std::shared_ptr<I> *result = 
+                        instance.load( std::memory_order_acquire );
+                    if( !result )
+                    {
+                        std::lock_guard<std::mutex> guard( construction_lock );
+                        result = instance.load( std::memory_order_relaxed );
+                        if( !result )
+                        {
+                            // If construction throws nothing is published
+                            // and the next resolution tries again.
+                            creator_type callable = creator;
+                            std::shared_ptr<I> created( plan.template 
+                                    resolve<std::shared_ptr<I>>( container_obj, callable ) );
+                            result = new std::shared_ptr<I>( created );
+                            instance.store( result, std::memory_order_release );
+                        }
+                    }
+                    return *result;
+                }
+
+                friend class base_factory<I>;
+
+                std::shared_ptr<I> internal_create_item() const
+                {
+                    return get_instance();
+                }
+
+                void *borrow_item() const
+                {
+                    return get_instance().get();
+                }
+
+            public:
+                singleton_factory( const std::string &name_in, 
+                        ioc::container &container_in )
+                    : base_factory<I>( name_in, 
+                            &base_factory<I>::template create_with<singleton_factory> ), 
+                    container_obj( container_in ),
+                    plan(), instance( NULL ), construction_lock()
+                {
+                }
+
+                ~singleton_factory()
+                {
+                    delete instance.load();
+                }
+        };
+
+    // per_graph_factory constructs a new object for each top level
+    // resolution but shares it within that resolution, so every
+    // part of one graph which depends on I is given the same object.
+    // Programs containing it open a resolution_context to share in;
+    // resolved outside of one it opens its own for its dependencies.
+    template<typename I, typename T, typename ...argtypes>
+        class per_graph_factory
+        : public base_factory<I>
+        {
+            private:
+                ioc::container &container_obj;
+                dependency_plan<argtypes...> plan;
+
+                static std::shared_ptr<I> creator( std::shared_ptr<argtypes>... args )
+                {
+                    return std::make_shared<T>( std::move( args )... );
+                }
+
+                std::shared_ptr<I> create() const
+                {
+                    std::shared_ptr<I> (*callable)( std::shared_ptr<argtypes>... ) = creator;
+                    return plan.template resolve<std::shared_ptr<I>>( container_obj, callable );
+                }
+
+                friend class base_factory<I>;
+
+                std::shared_ptr<I> internal_create_item() const
+                {
+                    std::shared_ptr<I> result;
+                    auto create_shared = [this]()
+                    {
+                        return create();
+                    };
+                    const resolution_context *context = 
+                        resolution_context::current( container_obj );
+                    if( context )
+                    {
+                        result = context->share<I>( this, create_shared );
+                    }
+                    else
+                    {
+                        resolution_context graph( container_obj );
+                        result = graph.share<I>( this, create_shared );
+                    }
+                    return result;
+                }
+
+            public:
+                per_graph_factory( const std::string &name_in, 
+                        ioc::container &container_in )
+                    : base_factory<I>( name_in, 
+                            &base_factory<I>::template create_with<per_graph_factory> ), 
+                    container_obj( container_in ), plan()
+                {
+                }
+
+                ~per_graph_factory()
+                {
+                }
+
+                void compile( construction_program &program_in ) const
+                {
+                    program_in.share_items();
+                    program_in.append_item<I>( this );
+                }
+        };
+
+    // pool_stats describes how a pooled registration has been used.
+    // A hit reuses an idle object, a miss constructs one, either into
+    // a free slot or, when every slot is in use, outside the pool.
+    struct pool_stats
+    {
+        size_t capacity;
+        size_t hits;
+        size_t misses;
+        size_t high_water_mark;
+
+        double hit_rate() const
+        {
+            const size_t total = hits + misses;
+            return total ? static_cast<double>( hits ) / total : 0.0;
+        }
+    };
+
+    // Factories which keep a pool of objects report its statistics
+    // through this interface.
+    class pooled_lifetime
+    {
+        public:
+            virtual ~pooled_lifetime()
+            {
+            }
+
+            virtual pool_stats get_pool_stats() const = 0;
+    };
+
+    // Atomics written by different threads are kept this far apart
+    // so they do not share a cache line.
+    static const size_t cache_line_size = 64;
+
+    // object_pool holds a fixed number of slots for objects of type T
+    // together with room for their shared_ptr control blocks, so
+    // handing out a pooled object allocates nothing. Free slots are
+    // kept on a lock-free list of slot indices tagged with a counter
+    // to rule out ABA. An object is reset when its last shared_ptr is
+    // released and its slot only returns to the list once the control
+    // block is gone. The pool is reference counted by its owner and
+    // every object handed out, so objects may outlive the factory.
+    // Hits and misses are counted in the slot they used, which the
+    // thread using it holds alone, so the only shared writes when an
+    // object is handed out and returned are to the list head and the
+    // reference count.
+    template<typename T>
+        class object_pool
+        {
+            public:
+                typedef void (*reset_type)( T & );
+
+            private:
+                static const uint32_t no_slot = 0xffffffff;
+                static const size_t control_size = 96;
+
+                struct slot
+                {
+                    typename std::aligned_storage<sizeof( T ), alignof( T )>::type object;
+                    typename std::aligned_storage<control_size, 
+                             alignof( std::max_align_t )>::type control;
+                    std::atomic<uint32_t> next;
+                    bool constructed;
+                    // Only written by the thread holding the slot
+                    std::atomic<size_t> hits;
+                    std::atomic<size_t> misses;
+                };
+
+                // Resets or destroys an object once it is released.
+                struct recycler
+                {
+                    object_pool *pool;
+                    uint32_t index;
+
+                    void operator()( T * ) const
+                    {
+                        pool->recycle( index );
+                    }
+                };
+
+                // Places the control block of an object in its slot and
+                // returns the slot to the pool when the block is freed.
+                template<typename U>
+                    struct control_allocator
+                    {
+                        typedef U value_type;
+
+                        template<typename V>
+                            struct rebind
+                            {
+                                typedef control_allocator<V> other;
+                            };
+
+                        object_pool *pool;
+                        uint32_t index;
+
+                        control_allocator( object_pool *pool_in, uint32_t index_in )
+                            : pool( pool_in ), index( index_in )
+                        {
+                        }
+
+                        template<typename V>
+                            control_allocator( const control_allocator<V> &other )
+                            : pool( other.pool ), index( other.index )
+                            {
+                            }
+
+                        U *allocate( size_t )
+                        {
+                            static_assert( sizeof( U ) <= control_size && 
+                                    alignof( U ) <= alignof( std::max_align_t ),
+                                    "shared_ptr control block does not fit a pool slot" );
+                            return reinterpret_cast<U *>( &pool->slots[index].control );
+                        }
+
+                        void deallocate( U *, size_t )
+                        {
+                            pool->give_back( index );
+                        }
+
+                        template<typename V>
+                            bool operator==( const control_allocator<V> &other ) const
+                            {
+                                return pool == other.pool && index == other.index;
+                            }
+
+                        template<typename V>
+                            bool operator!=( const control_allocator<V> &other ) const
+                            {
+                                return !( *this == other );
+                            }
+                    };
+
+                // Constructs an object in a slot from its dependencies.
+                template<typename ...argtypes>
+                    struct placer
+                    {
+                        void *storage;
+
+                        T *operator()( std::shared_ptr<argtypes>... args ) const
+                        {
+                            return new( storage ) T( std::move( args )... );
+                        }
+                    };
+
+                const uint32_t capacity;
+                const reset_type reset;
+                slot *const slots;
+                std::atomic<bool> closed;
+                // The list head has a cache line of its own, apart from
+                // the members above, which are read on every use, and
+                // from the counters below.
+                char before_head[cache_line_size];
+                std::atomic<uint64_t> head;
+                char after_head[cache_line_size];
+                // The owner's reference and one per object handed out
+                std::atomic<size_t> references;
+                std::atomic<size_t> high_water_mark;
+                // Misses while every slot was in use
+                std::atomic<size_t> overflows;
+                char after_counters[cache_line_size];
+
+                object_pool( const object_pool & );
+                object_pool &operator=( const object_pool & );
+
+                template<typename I, typename ...argtypes>
+                    static std::shared_ptr<I> create( std::shared_ptr<argtypes>... args )
+                    {
+                        return std::make_shared<T>( std::move( args )... );
+                    }
+
+                ~object_pool()
+                {
+                    for( uint32_t i = 0; i < capacity; i++ )
+                    {
+                        if( slots[i].constructed )
+                        {
+                            reinterpret_cast<T *>( &slots[i].object )->~T();
+                        }
+                    }
+                    delete[] slots;
+                }
+
+                void push( uint32_t index )
+                {
+                    uint64_t old = head.load( std::memory_order_relaxed );
+                    uint64_t desired = 0;
+                    do
+                    {
+                        slots[index].next.store( static_cast<uint32_t>( old ), 
+                                std::memory_order_relaxed );
+                        desired = ( ( ( old >> 32 ) + 1 ) << 32 ) | index;
+                    }
+                    while( !head.compare_exchange_weak( old, desired, 
+                                std::memory_order_release, std::memory_order_relaxed ) );
+                }
+
+                uint32_t pop()
+                {
+                    uint64_t old = head.load( std::memory_order_acquire );
+                    uint32_t result = static_cast<uint32_t>( old );
+                    while( result != no_slot )
+                    {
+                        // A stale next is harmless as the tag will
+                        // have moved on and the exchange fails.
+                        const uint64_t desired = ( ( ( old >> 32 ) + 1 ) << 32 ) | 
+                            slots[result].next.load( std::memory_order_relaxed );
+                        if( head.compare_exchange_weak( old, desired, 
+                                    std::memory_order_acquire, std::memory_order_acquire ) )
+                        {
+                            break;
+                        }
+                        result = static_cast<uint32_t>( old );
+                    }
+                    return result;
+                }
+
+                void recycle( uint32_t index )
+                {
+                    slot &s = slots[index];
+                    T *object = reinterpret_cast<T *>( &s.object );
+                    bool keep = !closed.load( std::memory_order_acquire );
+                    if( keep && reset )
+                    {
+                        try
+                        {
+                            reset( *object );
+                        }
+                        catch( ... )
+                        {
+                            keep = false;
+                        }
+                    }
+                    if( !keep )
+                    {
+                        object->~T();
+                        s.constructed = false;
+                    }
+                }
+
+                void give_back( uint32_t index )
+                {
+                    push( index );
+                    release();
+                }
+
+                // Count a use in a counter of the slot the caller holds.
+                // The reference taken for the object, less the owner's,
+                // gives the number of objects now handed out.
+                void record_use( std::atomic<size_t> &counter )
+                {
+                    counter.store( counter.load( std::memory_order_relaxed ) + 1, 
+                            std::memory_order_relaxed );
+                    const size_t now = references.fetch_add( 1, std::memory_order_relaxed );
+                    size_t high = high_water_mark.load( std::memory_order_relaxed );
+                    while( now > high && !high_water_mark.compare_exchange_weak( 
+                                high, now, std::memory_order_relaxed ) )
+                    {
+                    }
+                }
+
+            public:
+                object_pool( size_t capacity_in, reset_type reset_in )
+                    : capacity( static_cast<uint32_t>( 
+                                std::min<size_t>( capacity_in, no_slot - 1 ) ) ), 
+                    reset( reset_in ), slots( new slot[capacity ? capacity : 1] ), 
+                    closed( false ), head( no_slot ), references( 1 ), 
+                    high_water_mark( 0 ), overflows( 0 )
+                {
+                    for( uint32_t i = capacity; i > 0; i-- )
+                    {
+                        slots[i - 1].constructed = false;
+                        slots[i - 1].hits.store( 0, std::memory_order_relaxed );
+                        slots[i - 1].misses.store( 0, std::memory_order_relaxed );
+                        push( i - 1 );
+                    }
+                }
+
+                // Drop a reference. The owner calls this once it no
+                // longer hands out objects; idle objects are destroyed
+                // and the pool itself goes with the last reference.
+                void release()
+                {
+                    if( references.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+                    {
+                        delete this;
+                    }
+                }
+
+                void close()
+                {
+                    closed.store( true, std::memory_order_release );
+                    for( uint32_t index = pop(); index != no_slot; index = pop() )
+                    {
+                        if( slots[index].constructed )
+                        {
+                            reinterpret_cast<T *>( &slots[index].object )->~T();
+                            slots[index].constructed = false;
+                        }
+                    }
+                    release();
+                }
+
+                // Hand out an idle object, or construct one from the
+                // dependencies plan resolves. Objects built when the
+                // pool is exhausted are not pooled.
+                template<typename I, typename plan_type, typename resolver_type, 
+                    typename ...argtypes>
+                    std::shared_ptr<I> acquire( const plan_type &plan, 
+                            const resolver_type &resolver )
+                    {
+                        std::shared_ptr<I> result;
+                        const uint32_t index = pop();
+                        if( index == no_slot )
+                        {
+                            overflows.fetch_add( 1, std::memory_order_relaxed );
+                            typedef std::shared_ptr<I> (*creator_type)( 
+                                    std::shared_ptr<argtypes>... );
+                            creator_type creator = &create<I, argtypes...>;
+                            result = plan.template resolve<std::shared_ptr<I>>( 
+                                    resolver, creator );
+                        }
+                        else
+                        {
+                            slot &s = slots[index];
+                            if( s.constructed )
+                            {
+                                record_use( s.hits );
+                            }
+                            else
+                            {
+                                placer<argtypes...> place = { &s.object };
+                                try
+                                {
+                                    plan.template resolve<T *>( resolver, place );
+                                }
+                                catch( ... )
+                                {
+                                    push( index );
+                                    throw;
+                                }
+                                s.constructed = true;
+                                record_use( s.misses );
+                            }
+                            control_allocator<T> allocator( this, index );
+                            recycler deleter = { this, index };
+                            result = std::shared_ptr<I>( 
+                                    reinterpret_cast<T *>( &s.object ), deleter, allocator );
+                        }
+                        return result;
+                    }
+
+                pool_stats get_stats() const
+                {
+                    pool_stats result;
+                    result.capacity = capacity;
+                    result.hits = 0;
+                    result.misses = overflows.load( std::memory_order_relaxed );
+                    for( uint32_t i = 0; i < capacity; i++ )
+                    {
+                        result.hits += slots[i].hits.load( std::memory_order_relaxed );
+                        result.misses += slots[i].misses.load( std::memory_order_relaxed );
+                    }
+                    result.high_water_mark = high_water_mark.load( std::memory_order_relaxed );
+                    return result;
+                }
+        };
+
+    // pooled_factory hands out objects from an object_pool owned by
+    // the registration. Dependencies are only resolved when a new
+    // object has to be constructed.
+    template<typename I, typename T, typename ...argtypes>
+        class pooled_factory
+        : public base_factory<I>, public pooled_lifetime
+        {
+            private:
+                ioc::container &container_obj;
+                dependency_plan<argtypes...> plan;
+                object_pool<T> *const pool;
+
+                friend class base_factory<I>;
+
+                std::shared_ptr<I> internal_create_item() const
+                {
+                    return pool->template acquire<I, dependency_plan<argtypes...>, 
+                           ioc::container, argtypes...>( plan, container_obj );
+                }
+
+            public:
+                pooled_factory( const std::string &name_in, 
+                        ioc::container &container_in, size_t capacity_in,
+                        typename object_pool<T>::reset_type reset_in )
+                    : base_factory<I>( name_in, 
+                            &base_factory<I>::template create_with<pooled_factory> ), 
+                    container_obj( container_in ), plan(), 
+                    pool( new object_pool<T>( capacity_in, reset_in ) )
+                {
+                }
+
+                ~pooled_factory()
+                {
+                    pool->close();
+                }
+
+                pool_stats get_pool_stats() const
+                {
+                    return pool->get_stats();
+                }
+        };
+
+    // arena is a bump allocator. Memory is handed out from an inline
+    // buffer first and then from heap chunks of growing size. Nothing
+    // is released until the arena itself is destroyed, at which point
+    // every chunk is freed in one go. Objects placed in the arena are
+    // not destroyed by it.
+    // An arena is created on the heap and counts its users: the
+    // creator and every allocation made through an arena_allocator.
+    // The last user to release it destroys it, so memory handed out
+    // through an allocator stays valid until it has been deallocated.
+    class arena
+    {
+        private:
+            static const size_t inline_size = 1024;
+            static const size_t min_chunk_size = 4096;
+
+            struct chunk
+            {
+                chunk *next;
+            };
+
+            chunk *chunks;
+            char *current;
+            size_t remaining;
+            size_t next_chunk_size;
+            std::atomic<size_t> users;
+            char initial[inline_size];
+
+            arena( const arena & );
+            arena &operator=( const arena & );
+
+            void grow( size_t size )
+            {
+                size_t chunk_size = next_chunk_size;
+                while( chunk_size < size + sizeof( chunk ) + alignof( std::max_align_t ) )
+                {
+                    chunk_size *= 2;
+                }
+                chunk *c = static_cast<chunk *>( ::operator new( chunk_size ) );
+                c->next = chunks;
+                chunks = c;
+                current = reinterpret_cast<char *>( c + 1 );
+                remaining = chunk_size - sizeof( chunk );
+                next_chunk_size = chunk_size * 2;
+            }
+
+            arena() : chunks( NULL ), current( initial ), 
+                remaining( inline_size ), next_chunk_size( min_chunk_size ), 
+                users( 1 )
+            {
+            }
+
+            ~arena()
+            {
+                while( chunks )
+                {
+                    chunk *next = chunks->next;
+                    ::operator delete( chunks );
+                    chunks = next;
+                }
+            }
+
+        public:
+            // Create an arena with the caller as its only user
+            static arena *create()
+            {
+                return new arena();
+            }
+
+            void retain()
+            {
+                users.fetch_add( 1, std::memory_order_relaxed );
+            }
+
+            void release()
+            {
+                if( users.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+                {
+                    delete this;
+                }
+            }
+
+            void *allocate( size_t size, size_t alignment )
+            {
+                size_t padding = ( alignment - 
+                        reinterpret_cast<uintptr_t>( current ) % alignment ) % alignment;
+                if( padding + size > remaining )
+                {
+                    grow( size + alignment );
+                    padding = ( alignment - 
+                            reinterpret_cast<uintptr_t>( current ) % alignment ) % alignment;
+                }
+                void *result = current + padding;
+                current += padding + size;
+                remaining -= padding + size;
+                return result;
+            }
+    };
+
+    // arena_allocator adapts an arena to the standard allocator
+    // interface. Each allocation keeps the arena alive until it is
+    // deallocated, its memory is reclaimed when the arena is destroyed.
+    template<typename T>
+        class arena_allocator
+        {
+            private:
+                template<typename U>
+                    friend class arena_allocator;
+
+                arena *source;
+
+            public:
+                typedef T value_type;
+
+                explicit arena_allocator( arena &source_in ) : source( &source_in )
+                {
+                }
+
+                template<typename U>
+                    arena_allocator( const arena_allocator<U> &other ) 
+                    : source( other.source )
+                {
+                }
+
+                T *allocate( size_t n )
+                {
+                    T *result = static_cast<T *>( 
+                            source->allocate( n * sizeof( T ), alignof( T ) ) );
+                    source->retain();
+                    return result;
+                }
+
+                void deallocate( T *, size_t )
+                {
+                    source->release();
+                }
+
+                template<typename U>
+                    bool operator==( const arena_allocator<U> &other ) const
+                    {
+                        return source == other.source;
+                    }
+
+                template<typename U>
+                    bool operator!=( const arena_allocator<U> &other ) const
+                    {
+                        return source != other.source;
+                    }
+        };
+
+    template<typename I, typename T, typename ...argtypes>
+        class scoped_factory;
+
+    // Registration exception classes
+    class registration_exception : public std::exception
+    {
+        private:
+            std::string type_name;
+            std::string registration_name;
+            std::string error;
+
+        protected:
+            registration_exception( const std::string &type_name_in, 
+                    const std::string &registration_name_in,
+                    const std::string &reason_in )
+                : std::exception(), type_name( type_name_in ), 
+                registration_name( registration_name_in )
+        {
+            error = reason_in + std::string( " (Type: " ) +
+                    type_name + std::string( " , " ) + registration_name + 
+                    std::string( ")" );
+        }
+
+        public:
+            registration_exception( const std::string &type_name_in, 
+                    const std::string &registration_name_in )
+                : std::exception(), type_name( type_name_in ), 
+                registration_name( registration_name_in )
+        {
+            error = std::string( "Previous registration of type (Type: " ) +
+                    type_name + std::string( " , " ) + registration_name + 
+                    std::string( ")" );
+        }
+
+            ~registration_exception() throw()
+            {
+            }
+
+            const std::string &get_type_name() const
+            {
+                return type_name;
+            }
+
+            const std::string &get_registration_name() const
+            {
+                return registration_name;
+            }
+
+            const char *what() const throw()
+            {
+                return error.c_str(); 
+            }
+    };
+
+    // Thrown when registering with, or removing a registration from,
+    // a container which has been frozen.
+    class frozen_container_exception : public registration_exception
+    {
+        public:
+            frozen_container_exception( const std::string &type_name_in, 
+                    const std::string &registration_name_in )
+                : registration_exception( type_name_in, registration_name_in,
+                        "Container is frozen" )
+        {
+        }
+
+            ~frozen_container_exception() throw()
+            {
+            }
+    };
+
+    // Thrown when a registration name has the same hash as a
+    // different name already known to the container, which would
+    // make hashed_name lookups ambiguous.
+    class name_collision_exception : public registration_exception
+    {
+        public:
+            name_collision_exception( const std::string &registration_name_in )
+                : registration_exception( std::string(), registration_name_in,
+                        "Name hash collides with an existing name" )
+        {
+        }
+
+            ~name_collision_exception() throw()
+            {
+            }
+    };
+
+    // frozen_registry is the read-only form of a container's
+    // registrations. Default factories are stored contiguously and
+    // indexed by type_slot id. Named factories are laid out with a
+    // minimal perfect hash (hash and displace) over the pairs of type
+    // id and interned name id, so a named lookup probes exactly one
+    // entry.
+    class frozen_registry
+    {
+        public:
+            struct entry
+            {
+                size_t type_id;
+                size_t hash;
+                size_t name;
+                ifactory *factory;
+
+                entry() : type_id( 0 ), hash( 0 ), name( 0 ), factory( NULL )
+                {
+                }
+            };
+
+        private:
+            std::vector<ifactory *> defaults;
+            std::vector<entry> entries;
+            std::vector<size_t> displacements;
+
+            static size_t key_hash( size_t type_id, size_t name )
+            {
+                size_t h = name * 0x9e3779b9;
+                return h ^ ( type_id + 0x9e3779b9 + ( h << 6 ) + ( h >> 2 ) );
+            }
+
+            static size_t slot_for( size_t hash, size_t displacement, size_t count )
+            {
+                size_t x = hash ^ ( displacement * 0x9e3779b9 );
+                x ^= x >> 15;
+                x *= 0x2c1b3c6d;
+                x ^= x >> 12;
+                return x % count;
+            }
+
+            // Find a displacement per bucket, largest buckets first,
+            // which sends every key in the bucket to a free slot.
+            void build( std::vector<entry> &keys )
+            {
+                const size_t count = keys.size();
+                const size_t bucket_count = count / 2 + 1;
+                std::vector<std::vector<size_t>> buckets( bucket_count );
+                for( size_t i = 0; i < count; i++ )
+                {
+                    buckets[keys[i].hash % bucket_count].push_back( i );
+                }
+                std::vector<size_t> order( bucket_count );
+                for( size_t i = 0; i < bucket_count; i++ )
+                {
+                    order[i] = i;
+                }
+                std::sort( order.begin(), order.end(), 
+                        [&buckets]( size_t lhs, size_t rhs )
+                        {
+                            return buckets[lhs].size() > buckets[rhs].size();
+                        } );
+
+                std::vector<bool> taken( count, false );
+                std::vector<size_t> slots;
+                displacements.assign( bucket_count, 0 );
+                entries.resize( count );
+                for( size_t b = 0; b < bucket_count; b++ )
+                {
+                    const std::vector<size_t> &bucket = buckets[order[b]];
+                    if( bucket.empty() )
+                    {
+                        break;
+                    }
+                    for( size_t d = 0; ; d++ )
+                    {
+                        slots.clear();
+                        bool placed = true;
+                        for( size_t k = 0; k < bucket.size() && placed; k++ )
+                        {
+                            const size_t slot = slot_for( keys[bucket[k]].hash, d, count );
+                            placed = !taken[slot] && 
+                                std::find( slots.begin(), slots.end(), slot ) == slots.end();
+                            slots.push_back( slot );
+                        }
+                        if( placed )
+                        {
+                            for( size_t k = 0; k < bucket.size(); k++ )
+                            {
+                                taken[slots[k]] = true;
+                                entries[slots[k]] = std::move( keys[bucket[k]] );
+                            }
+                            displacements[order[b]] = d;
+                            break;
+                        }
+                    }
+                }
+            }
+
+        public:
+            frozen_registry( const std::vector<ifactory *> &defaults_in,
+                    std::vector<entry> &named_in )
+                : defaults( defaults_in ), entries(), displacements()
+            {
+                for( size_t i = 0; i < named_in.size(); i++ )
+                {
+                    named_in[i].hash = key_hash( named_in[i].type_id, named_in[i].name );
+                }
+                if( !named_in.empty() )
+                {
+                    build( named_in );
+                }
+            }
+
+            ifactory *find( size_t type_id ) const
+            {
+                return type_id < defaults.size() ? defaults[type_id] : NULL;
+            }
+
+            ifactory *find( size_t type_id, size_t name ) const
+            {
+                ifactory *result = NULL;
+                if( !entries.empty() )
+                {
+                    const size_t hash = key_hash( type_id, name );
+                    const entry &e = entries[slot_for( hash, 
+                            displacements[hash % displacements.size()], 
+                            entries.size() )];
+                    if( e.hash == hash && e.type_id == type_id && e.name == name )
+                    {
+                        result = e.factory;
+                    }
+                }
+                return result;
+            }
+    };
+
+    // Container. All object types are registered with the container
+    // at run-time and can then be resolved. Resolver supports
+    // constructor injection.
+    class container
+    {
+        public:
+            // Concurrency mode of a container. A concurrent container
+            // may be resolved from any number of threads while other
+            // threads register and remove types. Resolution takes no
+            // lock, readers see an immutable snapshot of the
+            // registrations and writers publish a new one.
+            enum concurrency
+            {
+                single_threaded,
+                concurrent
+            };
+
+        private:
+            template<typename T>
+            struct ellided_deleter
+            {
+                void operator()(T *val)
+                {
+                    // Shhhhh, don't actually delete the ptr.
+                }
+            };
+            typedef ellided_deleter<container> container_deleter;
+            
+            // An interned registration name. Ids start at 1 so that 0
+            // never names anything.
+            struct interned_name
+            {
+                std::string name;
+                uint64_t hash;
+                size_t id;
+            };
+
+            // Index of interned names by their hash, which is unique
+            // within a container, so a name and a hashed_name are found
+            // by the same probe. Names are only ever added. Each one is
+            // published into an empty slot with a single store, so
+            // readers probe without a lock while a writer adds names.
+            // A full index is replaced by one twice its size.
+            class name_table
+            {
+                private:
+                    const size_t mask;
+                    std::unique_ptr<std::atomic<const interned_name *>[]> slots;
+
+                    name_table( const name_table & );
+                    name_table &operator=( const name_table & );
+
+                public:
+                    explicit name_table( size_t capacity ) 
+                        : mask( capacity - 1 ), 
+                        slots( new std::atomic<const interned_name *>[capacity] )
+                    {
+                        for( size_t i = 0; i < capacity; i++ )
+                        {
+                            slots[i].store( NULL, std::memory_order_relaxed );
+                        }
+                    }
+
+                    size_t capacity() const
+                    {
+                        return mask + 1;
+                    }
+
+                    const interned_name *find( uint64_t hash ) const
+                    {
+                        size_t i = static_cast<size_t>( hash ) & mask;
+                        const interned_name *result = slots[i].load( std::memory_order_acquire );
+                        while( result && result->hash != hash )
+                        {
+                            i = ( i + 1 ) & mask;
+                            result = slots[i].load( std::memory_order_acquire );
+                        }
+                        return result;
+                    }
+
+                    // Only writers insert, and the index must have
+                    // an empty slot left.
+                    void insert( const interned_name *name )
+                    {
+                        size_t i = static_cast<size_t>( name->hash ) & mask;
+                        while( slots[i].load( std::memory_order_relaxed ) )
+                        {
+                            i = ( i + 1 ) & mask;
+                        }
+                        slots[i].store( name, std::memory_order_release );
+                    }
+            };
+
+            // Internal table of named instances of type factories
+            // keyed by interned name id.
+            typedef flat_table<size_t, ifactory*, std::hash<size_t>, 
+                    std::equal_to<size_t>, resource_allocator<size_t>> named_factory;
+
+            // All registrations for a single interface type. The default
+            // factory (the one with the lowest name) is cached in its own
+            // slot so unnamed resolution never has to visit the names.
+            struct registration
+            {
+                // Kept for diagnostics only, lookups go through
+                // the type_slot id.
+                const std::type_info *type;
+                ifactory *default_factory;
+                named_factory named;
+
+                explicit registration( memory_resource &resource_in ) 
+                    : type( NULL ), default_factory( NULL ), 
+                    named( resource_allocator<size_t>( resource_in ) )
+                {
+                }
+
+                // Recalculate the default factory after a removal.
+                void update_default()
+                {
+                    default_factory = NULL;
+                    for( named_factory::iterator c = named.begin();
+                            c != named.end(); ++c )
+                    {
+                        if( !default_factory ||
+                                c->value->get_name() < default_factory->get_name() )
+                        {
+                            default_factory = c->value;
+                        }
+                    }
+                }
+            };
+
+            // Registered types indexed by type_slot id. Slots for types
+            // which have never been registered are NULL. In a concurrent
+            // container a published table and the registrations it points
+            // to are never modified, writers publish a modified copy
+            // instead. A single_threaded container has no readers while
+            // it is written to, so it changes them in place.
+            typedef std::vector<const registration *, 
+                    resource_allocator<const registration *>> registration_types;
+
+            // Factories are destroyed through ifactory pointers, so each
+            // one is preceded by a record of the block it was built in.
+            struct factory_header
+            {
+                void *block;
+                size_t size;
+                size_t alignment;
+            };
+
+            // Readers announce themselves on one of several stripes,
+            // each on its own cache line, so concurrent resolutions do
+            // not all contend on the same line. A stripe counts readers
+            // separately for odd and even epochs.
+            static const size_t reader_stripe_count = 16;
+
+            struct alignas( cache_line_size ) reader_stripe
+            {
+                std::atomic<size_t> count[2];
+
+                reader_stripe()
+                {
+                    count[0].store( 0 );
+                    count[1].store( 0 );
+                }
+            };
+
+            // Marks the calling thread as reading the current table
+            // for its lifetime, counted against the epoch it started
+            // in. Only used by concurrent containers which are not
+            // frozen, see retire_program.
+            class read_guard
+            {
+                private:
+                    std::atomic<size_t> *counter;
+
+                    read_guard( const read_guard & );
+                    read_guard &operator=( const read_guard & );
+
+                public:
+                    read_guard( const container &container_in ) : counter( NULL )
+                    {
+                        if( container_in.mode == concurrent &&
+                                !container_in.frozen.load( std::memory_order_acquire ) )
+                        {
+                            counter = &container_in.readers[stripe_index()].count[ 
+                                container_in.epoch.load() & 1];
+                            counter->fetch_add( 1 );
+                        }
+                    }
+
+                    ~read_guard()
+                    {
+                        if( counter )
+                        {
+                            counter->fetch_sub( 1 );
+                        }
+                    }
+            };
+
+            // A batch of interfaces resolved together, identified by
+            // the type_slot of batch<interfaces...>.
+            template<typename ...interfaces>
+                struct batch
+                {
+                };
+
+            struct batch_program
+            {
+                const size_t id;
+                program_cache program;
+                batch_program *const next;
+
+                batch_program( size_t id_in, batch_program *next_in ) 
+                    : id( id_in ), program(), next( next_in )
+                {
+                }
+            };
+
+            // An object a writer has replaced, with the epoch in which
+            // it was retired and the function which frees it.
+            struct retired_object
+            {
+                size_t epoch;
+                const void *object;
+                void (*destroy)( container &, const void * );
+            };
+
+            const concurrency mode;
+            // Registrations, their tables and factories are allocated
+            // from here. Names and the frozen registry are not.
+            memory_resource &resource;
+            std::atomic<const registration_types *> types;
+            // Only writers add names. interned owns every name, in
+            // order of id.
+            std::atomic<name_table *> names;
+            std::vector<const interned_name *> interned;
+            // Bumped whenever a new table is published so that cached
+            // dependency plans know to rebuild.
+            std::atomic<size_t> generation;
+            // Set once by freeze(), after which types never changes.
+            std::atomic<const frozen_registry *> frozen;
+
+            // Advanced by writers once every reader which started
+            // before the current epoch has finished.
+            std::atomic<size_t> epoch;
+            // Tables, registrations, factories and programs replaced by
+            // a writer, oldest first. Each is kept until no reader can
+            // still be using it.
+            std::vector<retired_object> retired;
+            // Programs replaced after freeze(), freed with the container.
+            std::vector<const construction_program *> frozen_programs;
+            // The program of each batch resolve_all has been called
+            // for, newest first. Nodes are only added, under batch_lock,
+            // and freed with the container.
+            mutable std::atomic<batch_program *> batches;
+            mutable std::mutex batch_lock;
+
+            std::mutex write_lock;
+            // The stripes are built in reader_storage from its first
+            // cache line boundary on, as new does not honour the
+            // alignment of reader_stripe before C++17. The spare line
+            // leaves room to move up to the boundary.
+            char reader_storage[( reader_stripe_count + 1 ) * sizeof( reader_stripe )];
+            reader_stripe *const readers;
+
+            std::shared_ptr<container> self;
+
+            static reader_stripe *create_stripes( char *storage )
+            {
+                const uintptr_t address = reinterpret_cast<uintptr_t>( storage );
+                reader_stripe *result = reinterpret_cast<reader_stripe *>( storage +
+                        ( alignof( reader_stripe ) - address % alignof( reader_stripe ) ) %
+                        alignof( reader_stripe ) );
+                for( size_t i = 0; i < reader_stripe_count; i++ )
+                {
+                    new( result + i ) reader_stripe();
+                }
+                return result;
+            }
+
+            static size_t stripe_index()
+            {
+                static std::atomic<size_t> next( 0 );
+                static thread_local size_t index = 
+                    next.fetch_add( 1, std::memory_order_relaxed ) % reader_stripe_count;
+                return index;
+            }
+
+            // Return the registration for I or NULL if there
+            // are no factories for I.
+            template<typename I>
+                const registration *find_registration() const
+                {
+                    const size_t id = type_slot<I>::id();
+                    const registration_types *table = types.load();
+                    const registration *result = NULL;
+                    if( id < table->size() )
+                    {
+                        result = (*table)[id];
+                    }
+                    return result;
+                }
+
+            // Construct and destroy the container's own objects
+            // in its memory resource.
+            template<typename T, typename ...argtypes>
+                T *create_object( argtypes &&... args )
+                {
+                    void *memory = resource.allocate( sizeof( T ), alignof( T ) );
+                    T *result = NULL;
+                    try
+                    {
+                        result = new( memory ) T( std::forward<argtypes>( args )... );
+                    }
+                    catch( ... )
+                    {
+                        resource.deallocate( memory, sizeof( T ), alignof( T ) );
+                        throw;
+                    }
+                    return result;
+                }
+
+            template<typename T>
+                void destroy_object( const T *object )
+                {
+                    if( object )
+                    {
+                        object->~T();
+                        resource.deallocate( const_cast<T *>( object ), 
+                                sizeof( T ), alignof( T ) );
+                    }
+                }
+
+            template<typename F, typename ...argtypes>
+                F *create_factory( argtypes &&... args )
+                {
+                    const size_t alignment = 
+                        std::max( alignof( F ), alignof( factory_header ) );
+                    const size_t offset = ( sizeof( factory_header ) + alignof( F ) - 1 ) /
+                        alignof( F ) * alignof( F );
+                    const size_t size = offset + sizeof( F );
+                    char *block = static_cast<char *>( resource.allocate( size, alignment ) );
+                    F *result = NULL;
+                    try
+                    {
+                        result = new( block + offset ) F( std::forward<argtypes>( args )... );
+                    }
+                    catch( ... )
+                    {
+                        resource.deallocate( block, size, alignment );
+                        throw;
+                    }
+                    factory_header *header = 
+                        reinterpret_cast<factory_header *>( block + offset ) - 1;
+                    header->block = block;
+                    header->size = size;
+                    header->alignment = alignment;
+                    return result;
+                }
+
+            void destroy_factory( ifactory *factory )
+            {
+                if( factory )
+                {
+                    const factory_header header = 
+                        *( static_cast<factory_header *>( dynamic_cast<void *>( factory ) ) - 1 );
+                    factory->~ifactory();
+                    resource.deallocate( header.block, header.size, header.alignment );
+                }
+            }
+
+            // Return the id interned for name_in, or 0 if it has
+            // never been interned.
+            size_t find_name_id( const name_view &name_in ) const
+            {
+                const interned_name *found = names.load()->find( hash_name( name_in ) );
+                return found && name_view( found->name ) == name_in ? found->id : 0;
+            }
+
+            size_t find_name_id( const hashed_name &name_in ) const
+            {
+                const interned_name *found = names.load()->find( name_in.get() );
+                return found ? found->id : 0;
+            }
+
+            // Return the id for name_in, interning it if needed. The
+            // caller must hold the write lock. The index is kept at most
+            // half full, and grows by publishing a copy twice the size.
+            size_t intern_name_locked( const name_view &name_in )
+            {
+                const uint64_t hash = hash_name( name_in );
+                const interned_name *found = names.load()->find( hash );
+                size_t result = 0;
+                if( found )
+                {
+                    if( name_view( found->name ) != name_in )
+                    {
+                        throw name_collision_exception( name_in.str() );
+                    }
+                    result = found->id;
+                }
+                else
+                {
+                    name_table *table = names.load();
+                    if( ( interned.size() + 1 ) * 2 > table->capacity() )
+                    {
+                        name_table *grown = new name_table( table->capacity() * 2 );
+                        for( size_t i = 0; i < interned.size(); i++ )
+                        {
+                            grown->insert( interned[i] );
+                        }
+                        names.store( grown );
+                        retire( table );
+                        reclaim();
+                        table = grown;
+                    }
+                    std::unique_ptr<interned_name> added( new interned_name() );
+                    added->name = name_in.str();
+                    added->hash = hash;
+                    added->id = interned.size() + 1;
+                    interned.push_back( added.get() );
+                    table->insert( added.get() );
+                    result = added.release()->id;
+                }
+                return result;
+            }
+
+            // The registration of I for a writer to change, or a new
+            // one if I has none. A concurrent container gets a copy to
+            // publish. The caller must hold the write lock.
+            template<typename I>
+                registration *writable_registration()
+                {
+                    const registration *old = find_registration<I>();
+                    registration *result = NULL;
+                    if( old && mode == single_threaded )
+                    {
+                        result = const_cast<registration *>( old );
+                    }
+                    else if( old )
+                    {
+                        result = create_object<registration>( *old );
+                    }
+                    else
+                    {
+                        result = create_object<registration>( resource );
+                    }
+                    return result;
+                }
+
+            // Make replacement the registration for I, publishing a copy
+            // of the current table in a concurrent container. The caller
+            // must hold the write lock. The replaced registration and any
+            // factories the caller has retired are reclaimed once no
+            // reader can be using them.
+            template<typename I>
+                void publish_registration( const registration *replacement )
+                {
+                    const size_t id = type_slot<I>::id();
+                    const registration_types *old_table = types.load();
+                    registration_types *new_table = mode == single_threaded ? 
+                        const_cast<registration_types *>( old_table ) :
+                        create_object<registration_types>( *old_table );
+                    if( id >= new_table->size() )
+                    {
+                        new_table->resize( id + 1, NULL );
+                    }
+                    const registration *old_registration = (*new_table)[id];
+                    (*new_table)[id] = replacement;
+                    types.store( new_table );
+                    // Bump the generation before retiring so a reader
+                    // which could still be holding a plan that refers to
+                    // a retired factory started no later than its epoch.
+                    generation.fetch_add( 1 );
+
+                    if( new_table != old_table )
+                    {
+                        retire( old_table );
+                    }
+                    if( old_registration && old_registration != replacement )
+                    {
+                        retire( old_registration );
+                    }
+                    reclaim();
+                }
+
+            template<typename T>
+                static void destroy_retired( container &owner, const void *object )
+                {
+                    owner.destroy_object( static_cast<const T *>( object ) );
+                }
+
+            template<typename T>
+                static void delete_retired( container &, const void *object )
+                {
+                    delete static_cast<const T *>( object );
+                }
+
+            static void destroy_retired_factory( container &owner, const void *object )
+            {
+                owner.destroy_factory( 
+                        const_cast<ifactory *>( static_cast<const ifactory *>( object ) ) );
+            }
+
+            // Hand an object which is no longer reachable from the
+            // current tables to reclaim. The caller must hold the
+            // write lock.
+            void retire( const registration_types *table )
+            {
+                const retired_object r = { epoch.load(), table, 
+                    &container::destroy_retired<registration_types> };
+                retired.push_back( r );
+            }
+
+            void retire( const registration *registration_in )
+            {
+                const retired_object r = { epoch.load(), registration_in, 
+                    &container::destroy_retired<registration> };
+                retired.push_back( r );
+            }
+
+            void retire( const name_table *table )
+            {
+                const retired_object r = { epoch.load(), table, 
+                    &container::delete_retired<name_table> };
+                retired.push_back( r );
+            }
+
+            void retire( const construction_program *program )
+            {
+                const retired_object r = { epoch.load(), program, 
+                    &container::delete_retired<construction_program> };
+                retired.push_back( r );
+            }
+
+            void retire( ifactory *factory )
+            {
+                const retired_object r = { epoch.load(), factory, 
+                    &container::destroy_retired_factory };
+                retired.push_back( r );
+            }
+
+            // Move to the next epoch if no reader which started in the
+            // previous one is left. Readers count themselves against
+            // the parity of the epoch they read, so that is the parity
+            // the next epoch will reuse.
+            void advance_epoch()
+            {
+                const size_t current = epoch.load();
+                bool idle = true;
+                for( size_t i = 0; i < reader_stripe_count && idle; i++ )
+                {
+                    idle = readers[i].count[( current + 1 ) & 1].load() == 0;
+                }
+                if( idle )
+                {
+                    epoch.store( current + 1 );
+                }
+            }
+
+            // Free what has been retired and can no longer be in use. A
+            // single_threaded container frees everything at once. A
+            // concurrent one frees an object once the epoch has moved
+            // on twice since it was retired. Any reader which could have
+            // seen it started at the latest in the epoch it was retired
+            // in, and the second move waits for those readers to finish.
+            // Readers arriving later only see the current tables. Each
+            // stripe only has to drain the readers of one epoch, so
+            // reclamation keeps up with readers that never all stop.
+            void reclaim()
+            {
+                size_t freed = retired.size();
+                if( mode == concurrent )
+                {
+                    advance_epoch();
+                    const size_t current = epoch.load();
+                    freed = 0;
+                    while( freed < retired.size() && 
+                            retired[freed].epoch + 2 <= current )
+                    {
+                        freed++;
+                    }
+                }
+                for( size_t i = 0; i < freed; i++ )
+                {
+                    retired[i].destroy( *this, retired[i].object );
+                }
+                retired.erase( retired.begin(), retired.begin() + freed );
+            }
+
+            // Registration helper
+            template<typename F, typename I, typename ...argtypes>
+                name_id register_with_name_template( const std::string &name_in,
+                        argtypes... args )
+                {
+                    std::lock_guard<std::mutex> guard( write_lock );
+                    if( frozen.load() )
+                    {
+                        throw frozen_container_exception( typeid(I).name(), 
+                                name_in );
+                    }
+                    if( type_is_registered<I>( name_in ) )
+                    {
+                        // Throw an exception as we cannot register a type
+                        // which has already been registered
+                        throw registration_exception( typeid(I).name(), 
+                                name_in );
+                    }
+                    const size_t id = intern_name_locked( name_in );
+                    F *new_factory = create_factory<F>( name_in, args... );
+                    registration *r = writable_registration<I>();
+                    r->type = &typeid(I);
+                    r->named[id] = new_factory;
+                    // The default is the registration with the lowest
+                    // name, matching the ordering of earlier releases.
+                    if( !r->default_factory ||
+                            name_in < r->default_factory->get_name() )
+                    {
+                        r->default_factory = new_factory;
+                    }
+                    publish_registration<I>( r );
+                    return name_id( id );
+                }
+
+            // Dependency plans and construction programs look factories
+            // up directly and check the generation to see if they are
+            // still current.
+            template<typename ...argtypes>
+                friend class dependency_plan;
+            friend class construction_program;
+            friend class program_cache;
+
+            size_t get_generation() const
+            {
+                return generation.load( std::memory_order_acquire );
+            }
+
+            // Hand a replaced program to the container to be freed
+            // along with retired factories. Readers of a frozen
+            // container are not counted, so a program replaced after
+            // freeze() is kept until the container is destroyed.
+            // Registrations never change once frozen, so that is at
+            // most one program for each factory. A single_threaded
+            // container may also be resolved from several threads
+            // while nothing is registered, so its programs wait for
+            // the next registration, which never overlaps a resolution.
+            void retire_program( const construction_program *program )
+            {
+                std::lock_guard<std::mutex> guard( write_lock );
+                if( frozen.load() )
+                {
+                    frozen_programs.push_back( program );
+                }
+                else
+                {
+                    retire( program );
+                    if( mode == concurrent )
+                    {
+                        reclaim();
+                    }
+                }
+            }
+
+            // Resolve factory for interface. If that fails then return NULL.
+            template<typename I>
+                const ifactory *resolve_factory() const
+                {
+                    // Lookup interface type. If it cannot be found return
+                    // the default for that type.
+                    ifactory *result = NULL;
+                    const frozen_registry *f = frozen.load( std::memory_order_acquire );
+                    if( f )
+                    {
+                        result = f->find( type_slot<I>::id() );
+                    }
+                    else
+                    {
+                        const registration *r = find_registration<I>();
+                        if( r )
+                        {
+                            result = r->default_factory;
+                        }
+                    }
+                    return result;
+                }
+
+            // Resolve factory for interface type by interned name id.
+            // If that fails then return NULL.
+            template<typename I>
+                ifactory *
+                resolve_factory_by_id( size_t name_in ) const
+                {
+                    // Lookup interface type. If it cannot be found return
+                    // the default for that type.
+                    ifactory *result = NULL;
+                    const frozen_registry *f = frozen.load( std::memory_order_acquire );
+                    if( f )
+                    {
+                        result = f->find( type_slot<I>::id(), name_in );
+                    }
+                    else
+                    {
+                        const registration *r = find_registration<I>();
+                        if( r )
+                        {
+                            // We've got the type registered but we now need to look
+                            // up the named version.
+                            ifactory *const *c = r->named.find(name_in);
+                            if( c )
+                            {
+                                result = *c;
+                            }
+                        }
+                    }
+                    return result;
+                }
+
+            // Resolve factory for interface type by name. 
+            // If that fails then return NULL.
+            template<typename I>
+                ifactory *
+                resolve_factory_by_name( const name_view &name_in ) const
+                {
+                    return resolve_factory_by_id<I>( find_name_id( name_in ) );
+                }
+
+            // The program cache of the batch of interfaces, added the
+            // first time the batch is resolved.
+            template<typename ...interfaces>
+                program_cache &find_batch() const
+                {
+                    const size_t id = type_slot<batch<interfaces...>>::id();
+                    batch_program *result = batches.load( std::memory_order_acquire );
+                    while( result && result->id != id )
+                    {
+                        result = result->next;
+                    }
+                    if( !result )
+                    {
+                        std::lock_guard<std::mutex> guard( batch_lock );
+                        result = batches.load( std::memory_order_relaxed );
+                        while( result && result->id != id )
+                        {
+                            result = result->next;
+                        }
+                        if( !result )
+                        {
+                            result = new batch_program( id, 
+                                    batches.load( std::memory_order_relaxed ) );
+                            batches.store( result, std::memory_order_release );
+                        }
+                    }
+                    return result->program;
+                }
+
+            static pool_stats pool_stats_of( const ifactory *factory )
+            {
+                pool_stats result = pool_stats();
+                const pooled_lifetime *pooled = 
+                    dynamic_cast<const pooled_lifetime *>( factory );
+                if( pooled )
+                {
+                    result = pooled->get_pool_stats();
+                }
+                return result;
+            }
+            
+            
+
+        public:
+            // A scope resolves from its container but constructs each
+            // scoped registration at most once and shares it for the
+            // rest of the scope. Scoped objects, including their shared_ptr
+            // control blocks, are bump allocated from an arena owned by
+            // the scope. When the scope ends it drops its references,
+            // newest first, which destroys every object nothing else
+            // holds. An object which is still referenced, strongly or
+            // weakly, keeps the arena alive until it is released.
+            // A scope is not thread-safe and is intended to live for a
+            // single request. Outside of a scope, scoped registrations
+            // resolve to NULL.
+            class scope
+            {
+                private:
+                    template<typename I, typename T, typename ...argtypes>
+                        friend class scoped_factory;
+
+                    // Cached scoped objects form a list within the arena,
+                    // most recently constructed first.
+                    struct item
+                    {
+                        const ifactory *factory;
+                        std::shared_ptr<void> value;
+                        item *next;
+                    };
+
+                    // Make a scope the current scope for this thread for
+                    // the duration of a resolution.
+                    class activation
+                    {
+                        private:
+                            const scope *previous;
+                        public:
+                            activation( const scope *scope_in ) 
+                                : previous( current() )
+                            {
+                                current() = scope_in;
+                            }
+
+                            ~activation()
+                            {
+                                current() = previous;
+                            }
+                    };
+
+                    const container &owner;
+                    arena *const memory;
+                    mutable item *items;
+
+                    scope( const scope & );
+                    scope &operator=( const scope & );
+
+                    static const scope *&current()
+                    {
+                        static thread_local const scope *active = NULL;
+                        return active;
+                    }
+
+                    std::shared_ptr<void> find_item( const ifactory *factory ) const
+                    {
+                        std::shared_ptr<void> result;
+                        for( const item *i = items; i; i = i->next )
+                        {
+                            if( i->factory == factory )
+                            {
+                                result = i->value;
+                                break;
+                            }
+                        }
+                        return result;
+                    }
+
+                    void add_item( const ifactory *factory, 
+                            const std::shared_ptr<void> &value ) const
+                    {
+                        void *storage = memory->allocate( sizeof( item ), alignof( item ) );
+                        item *i = new (storage) item();
+                        i->factory = factory;
+                        i->value = value;
+                        i->next = items;
+                        items = i;
+                    }
+
+                    template<typename T>
+                        arena_allocator<T> get_allocator() const
+                        {
+                            return arena_allocator<T>( *memory );
+                        }
+
+                public:
+                    explicit scope( const container &owner_in ) 
+                        : owner( owner_in ), memory( arena::create() ), items( NULL )
+                    {
+                    }
+
+                    ~scope()
+                    {
+                        while( items )
+                        {
+                            item *next = items->next;
+                            items->~item();
+                            items = next;
+                        }
+                        memory->release();
+                    }
+
+                    template<typename I>
+                        std::shared_ptr<I> resolve() const
+                        {
+                            activation active( this );
+                            return owner.resolve<I>();
+                        }
+
+                    template<typename I>
+                        std::shared_ptr<I> resolve_by_name( const name_view &name_in ) const
+                        {
+                            activation active( this );
+                            return owner.resolve_by_name<I>( name_in );
+                        }
+
+                    template<typename I>
+                        std::shared_ptr<I> resolve_by_name( const name_id &name_in ) const
+                        {
+                            activation active( this );
+                            return owner.resolve_by_name<I>( name_in );
+                        }
+
+                    template<typename I>
+                        std::shared_ptr<I> resolve_by_name( const hashed_name &name_in ) const
+                        {
+                            activation active( this );
+                            return owner.resolve_by_name<I>( name_in );
+                        }
+            };
+
+            // A handle resolves one registration of I, either the default
+            // or a named one, without looking it up each time. It caches
+            // the factory together with the container generation and
+            // only looks the factory up again after a registration has
+            // changed, so re-registration still takes effect. A handle
+            // may be copied freely but a single handle must not be
+            // resolved from on several threads at once.
+            template<typename I>
+                class handle
+                {
+                    private:
+                        friend class container;
+
+                        const container *owner;
+                        bool named;
+                        size_t name;
+                        const ifactory *factory;
+                        size_t generation;
+
+                        handle( const container &owner_in, bool named_in, 
+                                size_t name_in )
+                            : owner( &owner_in ), named( named_in ), name( name_in ),
+                            factory( NULL ), generation( static_cast<size_t>( -1 ) )
+                        {
+                        }
+
+                    public:
+                        std::shared_ptr<I> resolve()
+                        {
+                            read_guard guard( *owner );
+                            resolution_context::isolation outside;
+                            const size_t current = owner->get_generation();
+                            if( generation != current )
+                            {
+                                factory = named ? owner->resolve_factory_by_id<I>( name ) :
+                                    owner->resolve_factory<I>();
+                                generation = current;
+                            }
+                            std::shared_ptr<I> result;
+                            if( factory )
+                            {
+                                result = factory->create_item<I>();
+                            }
+                            return result;
+                        }
+                };
+
+            explicit container( concurrency mode_in = single_threaded ) 
+                : container( *new_delete_resource(), mode_in )
+            {
+            }
+
+            // The container allocates its registrations and factories
+            // from resource_in, which must outlive it.
+            explicit container( memory_resource &resource_in, 
+                    concurrency mode_in = single_threaded ) 
+                : mode( mode_in ), resource( resource_in ), 
+                types( create_object<registration_types>( 
+                            resource_allocator<const registration *>( resource_in ) ) ), 
+                names( new name_table( 16 ) ), interned(), generation( 0 ), frozen( NULL ),
+                epoch( 0 ), retired(), frozen_programs(), batches( NULL ), batch_lock(), 
+                write_lock(), readers( create_stripes( reader_storage ) ), 
+                self(this, container_deleter())
+            {
+                // Register our special shared_ptr which will not
+                // delete if a container is resolved.
+                this->register_instance<container>(self);
+            }
+
+            ~container()
+            {
+                // Destroy all factories
+                const registration_types *table = types.load();
+                for( registration_types::const_iterator i = table->begin();
+                        i != table->end(); ++i )
+                {
+                    if( *i )
+                    {
+                        for( named_factory::const_iterator j = (*i)->named.begin();
+                                j != (*i)->named.end(); ++j )
+                        {
+                            destroy_factory( j->value );
+                        }
+                        destroy_object( *i );
                     }
-                    i->second.clear();
                 }
+                destroy_object( table );
+                types.store( NULL );
+                delete names.load();
+                for( size_t i = 0; i < interned.size(); i++ )
+                {
+                    delete interned[i];
+                }
+                delete frozen.load();
 
-                types.clear();
+                // Nothing can be reading once we are being destroyed
+                for( size_t i = 0; i < retired.size(); i++ )
+                {
+                    retired[i].destroy( *this, retired[i].object );
+                }
+                for( size_t i = 0; i < frozen_programs.size(); i++ )
+                {
+                    delete frozen_programs[i];
+                }
+                for( batch_program *i = batches.load(); i; )
+                {
+                    batch_program *next = i->next;
+                    delete i;
+                    i = next;
+                }
             }
 
             // Check if a factory to create a gievn interface
             // already exists
             template<typename I>
-                bool type_is_registered( const std::string &name_in ) const
+                bool type_is_registered( const name_view &name_in ) const
                 {
+                    read_guard guard( *this );
                     const ifactory *f = resolve_factory_by_name<I>( name_in );    
                     return f ? true : false;
                 }
 
+            template<typename I>
+                bool type_is_registered( const name_id &name_in ) const
+                {
+                    read_guard guard( *this );
+                    const ifactory *f = resolve_factory_by_id<I>( name_in.value );    
+                    return f ? true : false;
+                }
+
+            template<typename I>
+                bool type_is_registered( const hashed_name &name_in ) const
+                {
+                    read_guard guard( *this );
+                    const ifactory *f = 
+                        resolve_factory_by_id<I>( find_name_id( name_in ) );    
+                    return f ? true : false;
+                }
+
             template<typename I>
                 bool type_is_registered() const
                 {
+                    read_guard guard( *this );
                     const ifactory *f = resolve_factory<I>();    
                     return f ? true : false;
                 }
@@ -387,14 +3688,14 @@ namespace ioc
 
 
             template<typename I, typename callable, typename ...argtypes>
-                void register_delegate_with_name( const std::string &name_in,
+                name_id register_delegate_with_name( const std::string &name_in,
                         callable call_obj )
                 {
                     // Create a functor which returns an Interface type
                     // but actually news a Concretion.
                     typedef delegate_factory<I, callable, argtypes...> 
                         factorytype;
-                    register_with_name_template<factorytype, I,
+                    return register_with_name_template<factorytype, I,
                         ioc::container &, callable>( name_in, *this, call_obj );
                 }
 
@@ -407,10 +3708,10 @@ namespace ioc
                 }
 
             template<typename I, typename T, typename ...argtypes>
-                void register_type_with_name( const std::string &name_in )
+                name_id register_type_with_name( const std::string &name_in )
                 {
                     typedef resolvable_factory<I, T, argtypes...> factorytype;
-                    register_with_name_template<factorytype, I, 
+                    return register_with_name_template<factorytype, I, 
                         ioc::container &>( name_in, *this );
                 }
 
@@ -422,13 +3723,121 @@ namespace ioc
                             unnamed_type_name_registration );
                 }
 
+            // As above but each resolved instance, together with its
+            // shared_ptr control block, is allocated from products_in.
+            template<typename I, typename T, typename ...argtypes>
+                name_id register_type_with_name( const std::string &name_in, 
+                        memory_resource &products_in )
+                {
+                    typedef resolvable_factory<I, T, argtypes...> factorytype;
+                    return register_with_name_template<factorytype, I, 
+                        ioc::container &, memory_resource *>( 
+                                name_in, *this, &products_in );
+                }
+
+            template<typename I, typename T, typename ...argtypes>
+                void register_type( memory_resource &products_in )
+                {
+                    register_type_with_name<I, T, argtypes...>( 
+                            unnamed_type_name_registration, products_in );
+                }
+
+            template<typename I, typename T, typename ...argtypes>
+                name_id register_singleton_with_name( const std::string &name_in )
+                {
+                    typedef singleton_factory<I, T, argtypes...> factorytype;
+                    return register_with_name_template<factorytype, I, 
+                        ioc::container &>( name_in, *this );
+                }
+
+            template<typename I, typename T, typename ...argtypes>
+                void register_singleton()
+                {
+                    // Register nameless lazily constructed singleton
+                    register_singleton_with_name<I, T, argtypes...>( 
+                            unnamed_type_name_registration );
+                }
+
+            // Resolved objects are shared within a single resolution.
+            // Each top level resolve constructs at most one object for
+            // the registration and gives it to every part of the graph
+            // which depends on I.
+            template<typename I, typename T, typename ...argtypes>
+                name_id register_per_graph_with_name( const std::string &name_in )
+                {
+                    typedef per_graph_factory<I, T, argtypes...> factorytype;
+                    return register_with_name_template<factorytype, I, 
+                        ioc::container &>( name_in, *this );
+                }
+
+            template<typename I, typename T, typename ...argtypes>
+                void register_per_graph()
+                {
+                    register_per_graph_with_name<I, T, argtypes...>( 
+                            unnamed_type_name_registration );
+                }
+
+            // Resolved objects are recycled through a pool of up to
+            // capacity objects instead of being deleted. reset_in, if
+            // given, is called on each object as it is returned.
+            template<typename I, typename T, typename ...argtypes>
+                name_id register_pooled_with_name( const std::string &name_in, 
+                        size_t capacity, 
+                        typename object_pool<T>::reset_type reset_in = NULL )
+                {
+                    typedef pooled_factory<I, T, argtypes...> factorytype;
+                    return register_with_name_template<factorytype, I, 
+                        ioc::container &, size_t, typename object_pool<T>::reset_type>( 
+                                name_in, *this, capacity, reset_in );
+                }
+
+            template<typename I, typename T, typename ...argtypes>
+                void register_pooled( size_t capacity, 
+                        typename object_pool<T>::reset_type reset_in = NULL )
+                {
+                    register_pooled_with_name<I, T, argtypes...>( 
+                            unnamed_type_name_registration, capacity, reset_in );
+                }
+
+            // Statistics of the pool behind a pooled registration. Any
+            // other registration reports an empty pool.
+            template<typename I>
+                pool_stats get_pool_stats() const
+                {
+                    read_guard guard( *this );
+                    return pool_stats_of( resolve_factory<I>() );
+                }
+
+            template<typename I>
+                pool_stats get_pool_stats( const name_view &name_in ) const
+                {
+                    read_guard guard( *this );
+                    return pool_stats_of( resolve_factory_by_name<I>( name_in ) );
+                }
+
+            template<typename I, typename T, typename ...argtypes>
+                name_id register_scoped_with_name( const std::string &name_in )
+                {
+                    typedef scoped_factory<I, T, argtypes...> factorytype;
+                    return register_with_name_template<factorytype, I, 
+                        ioc::container &>( name_in, *this );
+                }
+
+            template<typename I, typename T, typename ...argtypes>
+                void register_scoped()
+                {
+                    // Register nameless scoped constructor
+                    register_scoped_with_name<I, T, argtypes...>( 
+                            unnamed_type_name_registration );
+                }
+
             template<typename I>
-                void register_instance_with_name( const std::string &name_in,
+                name_id register_instance_with_name( const std::string &name_in,
                         std::shared_ptr<I> instance_in )
                 {
                     // Create instance constuctor and register in our type list
                     typedef instance_factory<I> factorytype;
-                    register_with_name_template<factorytype, I, std::shared_ptr<I>>( 
+                    return register_with_name_template<factorytype, I, std::shared_ptr<I>>( 
                             name_in, 
                             instance_in );
                 }
@@ -445,44 +3854,250 @@ namespace ioc
             template<typename I>
                 std::shared_ptr<I> resolve() const
                 {
+                    read_guard guard( *this );
+                    resolution_context::isolation outside;
+                    std::shared_ptr<I> result;
+                    const ifactory *factory = resolve_factory<I>();
+                    if( factory )
+                    {
+                        result = factory->create_item<I>();
+                    }
+
+                    return result;
+                }
+
+            // Resolve several interfaces together. The batch is compiled
+            // into a single program, which looks every registration of
+            // its graph up once and is cached until a registration
+            // changes. Within the batch each registration is constructed
+            // at most once, so a dependency shared by several of the
+            // interfaces, or an interface listed twice, resolves to the
+            // same object. A registration which constructs its object
+            // itself, such as a singleton on first use, resolves its own
+            // dependencies outside the batch. Interfaces which are not
+            // registered resolve to NULL.
+            template<typename ...interfaces>
+                std::tuple<std::shared_ptr<interfaces>...> resolve_all() const
+                {
+                    read_guard guard( *this );
+                    resolution_context::isolation outside;
+                    // Replacing an out of date program retires it, which
+                    // is a write to the container.
+                    return find_batch<interfaces...>().template run_all<interfaces...>( 
+                            const_cast<container &>( *this ) );
+                }
+
+            // Borrow the object of an instance or singleton registration
+            // without taking a reference to it. The object stays valid
+            // until the registration is removed or replaced or the
+            // container is destroyed. Returns NULL if I is not registered
+            // or its registration constructs a new object each time.
+            template<typename I>
+                I *resolve_ref() const
+                {
+                    read_guard guard( *this );
+                    resolution_context::isolation outside;
                     I *result = NULL;
                     const ifactory *factory = resolve_factory<I>();
                     if( factory )
                     {
-                        result = reinterpret_cast<I *>( factory->create_item() );
+                        result = static_cast<I *>( factory->borrow_item() );
+                    }
+                    return result;
+                }
+
+            template<typename I>
+                I *resolve_ref( const name_view &name_in ) const
+                {
+                    read_guard guard( *this );
+                    resolution_context::isolation outside;
+                    I *result = NULL;
+                    const ifactory *factory = resolve_factory_by_name<I>( name_in );
+                    if( factory )
+                    {
+                        result = static_cast<I *>( factory->borrow_item() );
                     }
+                    return result;
+                }
 
-                    return std::shared_ptr<I>(result);
+            template<typename I>
+                I *resolve_ref( const name_id &name_in ) const
+                {
+                    read_guard guard( *this );
+                    resolution_context::isolation outside;
+                    I *result = NULL;
+                    const ifactory *factory = resolve_factory_by_id<I>( name_in.value );
+                    if( factory )
+                    {
+                        result = static_cast<I *>( factory->borrow_item() );
+                    }
+                    return result;
                 }
 
-            // Resolve interface type by name. If that fails then return NULL.
             template<typename I>
-                std::shared_ptr<I> resolve_by_name( const std::string &name_in ) const
+                I *resolve_ref( const hashed_name &name_in ) const
                 {
+                    read_guard guard( *this );
+                    resolution_context::isolation outside;
                     I *result = NULL;
+                    const ifactory *factory = 
+                        resolve_factory_by_id<I>( find_name_id( name_in ) );
+                    if( factory )
+                    {
+                        result = static_cast<I *>( factory->borrow_item() );
+                    }
+                    return result;
+                }
+
+            // Resolve interface type by name. If that fails then return NULL.
+            template<typename I>
+                std::shared_ptr<I> resolve_by_name( const name_view &name_in ) const
+                {
+                    read_guard guard( *this );
+                    resolution_context::isolation outside;
+                    std::shared_ptr<I> result;
                     const ifactory *factory = 
                         resolve_factory_by_name<I>( name_in );
                     if( factory )
                     {
-                        result = reinterpret_cast<I *>( factory->create_item() );
+                        result = factory->create_item<I>();
+                    }
+                    return result;
+                }
+
+            // Resolve interface type by an interned name. If that fails
+            // then return NULL.
+            template<typename I>
+                std::shared_ptr<I> resolve_by_name( const name_id &name_in ) const
+                {
+                    read_guard guard( *this );
+                    resolution_context::isolation outside;
+                    std::shared_ptr<I> result;
+                    const ifactory *factory = 
+                        resolve_factory_by_id<I>( name_in.value );
+                    if( factory )
+                    {
+                        result = factory->create_item<I>();
+                    }
+                    return result;
+                }
+
+            // Resolve interface type by the hash of its name. If that
+            // fails then return NULL.
+            template<typename I>
+                std::shared_ptr<I> resolve_by_name( const hashed_name &name_in ) const
+                {
+                    read_guard guard( *this );
+                    resolution_context::isolation outside;
+                    std::shared_ptr<I> result;
+                    const ifactory *factory = 
+                        resolve_factory_by_id<I>( find_name_id( name_in ) );
+                    if( factory )
+                    {
+                        result = factory->create_item<I>();
+                    }
+                    return result;
+                }
+
+            // Return a handle to the default registration of I
+            template<typename I>
+                handle<I> get_handle() const
+                {
+                    return handle<I>( *this, false, 0 );
+                }
+
+            // Return a handle to the registration of I named name_in
+            template<typename I>
+                handle<I> get_handle( const name_id &name_in ) const
+                {
+                    return handle<I>( *this, true, name_in.value );
+                }
+
+            template<typename I>
+                handle<I> get_handle( const name_view &name_in )
+                {
+                    return get_handle<I>( intern_name( name_in ) );
+                }
+
+            // Return the handle for a registration name, interning it
+            // if it has not been seen. Registration interns names too,
+            // and returns the same handle. A frozen container interns
+            // nothing new, so unseen names give an invalid handle.
+            name_id intern_name( const name_view &name_in )
+            {
+                std::lock_guard<std::mutex> guard( write_lock );
+                size_t result = 0;
+                if( frozen.load() )
+                {
+                    result = find_name_id( name_in );
+                }
+                else
+                {
+                    result = intern_name_locked( name_in );
+                }
+                return name_id( result );
+            }
+
+            // Build a read-only snapshot of the current registrations
+            // and resolve from it from now on. Resolution from a frozen
+            // container needs no synchronisation whatever its mode.
+            // Any later attempt to register or remove a type throws
+            // a frozen_container_exception.
+            void freeze()
+            {
+                std::lock_guard<std::mutex> guard( write_lock );
+                if( !frozen.load() )
+                {
+                    const registration_types *table = types.load();
+                    std::vector<ifactory *> defaults( table->size(), NULL );
+                    std::vector<frozen_registry::entry> named;
+                    for( size_t id = 0; id < table->size(); id++ )
+                    {
+                        const registration *r = (*table)[id];
+                        if( r )
+                        {
+                            defaults[id] = r->default_factory;
+                            for( named_factory::const_iterator j = r->named.begin();
+                                    j != r->named.end(); ++j )
+                            {
+                                frozen_registry::entry e;
+                                e.type_id = id;
+                                e.name = j->key;
+                                e.factory = j->value;
+                                named.push_back( e );
+                            }
+                        }
                     }
-                    return std::shared_ptr<I>(result);
+                    frozen.store( new frozen_registry( defaults, named ) );
+                    reclaim();
                 }
+            }
+
+            bool is_frozen() const
+            {
+                return frozen.load() != NULL;
+            }
 
             // Destroy all factories implementing the given interface
             template<typename I>
                 bool remove_registration()
                 {
+                    std::lock_guard<std::mutex> guard( write_lock );
+                    if( frozen.load() )
+                    {
+                        throw frozen_container_exception( typeid(I).name(), 
+                                std::string() );
+                    }
                     bool result = false;
-                    registration_types::iterator i = types.find(std::type_index(typeid(I)));
-                    if( i != types.end() )
+                    const registration *r = find_registration<I>();
+                    if( r )
                     {
-                        for( named_factory::iterator j = i->second.begin(); 
-                                j != i->second.end(); ++j )
+                        for( named_factory::const_iterator j = r->named.begin();
+                                j != r->named.end(); ++j )
                         {
-                            destroy_factory( j->second );
+                            retire( j->value );
                         }
-                        types.erase(i);
+                        publish_registration<I>( NULL );
                         result = true;
                     }
                     return result;
@@ -491,23 +4106,250 @@ namespace ioc
             // Destroy the first named factory which creates an
             // interface
             template<typename I>
-                bool remove_registration_by_name( const std::string &name_in )
+                bool remove_registration_by_name( const name_view &name_in )
                 {
+                    std::lock_guard<std::mutex> guard( write_lock );
+                    if( frozen.load() )
+                    {
+                        throw frozen_container_exception( typeid(I).name(), 
+                                name_in.str() );
+                    }
                     bool result = false;
-                    registration_types::iterator i = types.find(std::type_index(typeid(I)));
-                    if( i != types.end() )
+                    const registration *r = find_registration<I>();
+                    if( r )
                     {
-                        named_factory::iterator j = i->second.find(name_in); 
-                        if( j != i->second.end() )
+                        const size_t id = find_name_id( name_in );
+                        ifactory *const *j = r->named.find(id);
+                        if( j )
                         {
-                            destroy_factory( j->second );
-                            i->second.erase( j );
-                           result = true; 
+                            ifactory *removed = *j;
+                            retire( removed );
+                            // Drop the type altogether once its last
+                            // named factory has gone.
+                            registration *replacement = NULL;
+                            if( r->named.size() > 1 )
+                            {
+                                replacement = writable_registration<I>();
+                                replacement->named.erase( id );
+                                if( removed == replacement->default_factory )
+                                {
+                                    replacement->update_default();
+                                }
+                            }
+                            publish_registration<I>( replacement );
+                            result = true;
                         }
                     }
                     return result;
                 }
     }; // namespace IOC
+
+    // scoped_factory constructs T at most once per container::scope.
+    // The object and its control block are allocated from the arena
+    // of the scope which is active on the resolving thread.
+    template<typename I, typename T, typename ...argtypes>
+        class scoped_factory
+        : public base_factory<I>
+        {
+            private:
+                ioc::container &container_obj;
+                dependency_plan<argtypes...> plan;
+
+                friend class base_factory<I>;
+
+                std::shared_ptr<I> internal_create_item() const
+                {
+                    std::shared_ptr<I> result;
+                    const container::scope *active = container::scope::current();
+                    if( active && &active->owner == &container_obj )
+                    {
+                        result = std::static_pointer_cast<I>( 
+                                active->find_item( this ) );
+                        if( !result )
+                        {
+                            // Dependencies resolve with this scope still
+                            // active so scoped dependencies are shared too.
+                            const arena_allocator<T> allocator = 
+                                active->template get_allocator<T>();
+                            auto creator = [&allocator]( std::shared_ptr<argtypes>... args )
+                            {
+                                return std::allocate_shared<T>( allocator, std::move( args )... );
+                            };
+                            result = plan.template resolve<std::shared_ptr<I>>( 
+                                    container_obj, creator );
+                            active->add_item( this, result );
+                        }
+                    }
+                    return result;
+                }
+
+            public:
+                scoped_factory( const std::string &name_in, 
+                        ioc::container &container_in )
+                    : base_factory<I>( name_in, 
+                            &base_factory<I>::template create_with<scoped_factory> ), 
+                    container_obj( container_in ), plan()
+                {
+                }
+
+                ~scoped_factory()
+                {
+                }
+        };
+
+    // Compile time bindings for static_container. bind constructs
+    // a new T for every resolution of I, bind_singleton constructs
+    // T once per static_container and shares it.
+    template<typename I, typename T, typename ...argtypes>
+        struct bind
+        {
+            typedef I interface_type;
+        };
+
+    template<typename I, typename T, typename ...argtypes>
+        struct bind_singleton
+        {
+            typedef I interface_type;
+        };
+
+    // Index of the first binding for I, or the number of
+    // bindings if there is none.
+    template<typename I, size_t index, typename ...bindings>
+        struct binding_index : std::integral_constant<size_t, index>
+        {
+        };
+
+    template<typename I, size_t index, typename binding, typename ...bindings>
+        struct binding_index<I, index, binding, bindings...>
+        : std::conditional<
+          std::is_same<I, typename binding::interface_type>::value,
+          std::integral_constant<size_t, index>,
+          binding_index<I, index + 1, bindings...> >::type
+        {
+        };
+
+    // static_binding holds any state a binding needs and
+    // constructs its type from dependencies resolved by
+    // the owning static_container.
+    template<typename binding>
+        class static_binding;
+
+    template<typename I, typename T, typename ...argtypes>
+        class static_binding<bind<I, T, argtypes...>>
+        {
+            public:
+                template<typename resolver_type>
+                    std::shared_ptr<I> resolve( const resolver_type &resolver ) const
+                    {
+                        return std::make_shared<T>( 
+                                resolver.template resolve<argtypes>()... );
+                    }
+        };
+
+    template<typename I, typename T, typename ...argtypes>
+        class static_binding<bind_singleton<I, T, argtypes...>>
+        {
+            private:
+                mutable std::atomic<std::shared_ptr<I> *> instance;
+                mutable std::mutex construction_lock;
+
+                static_binding( const static_binding & );
+                static_binding &operator=( const static_binding & );
+
+            public:
+                static_binding() : instance( NULL ), construction_lock()
+                {
+                }
+
+                ~static_binding()
+                {
+                    delete instance.load();
+                }
+
+                template<typename resolver_type>
+                    std::shared_ptr<I> resolve( const resolver_type &resolver ) const
+                    {
+                        std::shared_ptr<I> *result = 
+                            instance.load( std::memory_order_acquire );
+                        if( !result )
+                        {
+                            std::lock_guard<std::mutex> guard( construction_lock );
+                            result = instance.load( std::memory_order_relaxed );
+                            if( !result )
+                            {
+                                // If construction throws nothing is published
+                                // and the next resolution tries again.
+                                std::shared_ptr<I> created( std::make_shared<T>( 
+                                            resolver.template resolve<argtypes>()... ) );
+                                result = new std::shared_ptr<I>( created );
+                                instance.store( result, std::memory_order_release );
+                            }
+                        }
+                        return *result;
+                    }
+        };
+
+    // static_container resolves a fixed set of bindings chosen at
+    // compile time. The binding for a type is found by the compiler,
+    // so resolution inlines to a direct make_shared, or a singleton
+    // load, with no registry lookup and no virtual dispatch. Types
+    // without a binding, including dependencies of bound types, are
+    // resolved from an optional runtime container and resolve to
+    // NULL without one.
+    template<typename ...bindings>
+        class static_container
+        {
+            private:
+                static const size_t binding_count = sizeof...(bindings);
+
+                container *fallback;
+                std::tuple<static_binding<bindings>...> table;
+
+                static_container( const static_container & );
+                static_container &operator=( const static_container & );
+
+                template<typename I>
+                    std::shared_ptr<I> resolve_binding( std::true_type ) const
+                    {
+                        return std::get<binding_index<I, 0, bindings...>::value>( 
+                                table ).resolve( *this );
+                    }
+
+                template<typename I>
+                    std::shared_ptr<I> resolve_binding( std::false_type ) const
+                    {
+                        std::shared_ptr<I> result;
+                        if( fallback )
+                        {
+                            result = fallback->resolve<I>();
+                        }
+                        return result;
+                    }
+
+            public:
+                static_container() : fallback( NULL ), table()
+                {
+                }
+
+                explicit static_container( container &fallback_in ) 
+                    : fallback( &fallback_in ), table()
+                {
+                }
+
+                // True if I has a compile time binding
+                template<typename I>
+                    static bool is_bound()
+                    {
+                        return binding_index<I, 0, bindings...>::value != binding_count;
+                    }
+
+                template<typename I>
+                    std::shared_ptr<I> resolve() const
+                    {
+                        return resolve_binding<I>( std::integral_constant<bool,
+                                binding_index<I, 0, bindings...>::value != binding_count>() );
+                    }
+        };
 };
 #endif // IOC_H
 
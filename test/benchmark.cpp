@@ -0,0 +1,572 @@
+/*
+ * benchmark.cpp - Microbenchmarks for the IOC container
+ *
+ * Copyright (c) 2012 Nicholas A. Smith (nickrmc83@gmail.com)
+ * Distributed under the Boost software license 1.0,
+ * see boost.org for a copy.
+ */
+
+#include <ioc_container/ioc.h>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+
+// Counter to measure the number of heap allocations
+// made through the global operator new. The replacements are
+// kept out of line so the optimiser still pairs new with delete.
+static size_t AllocationCount;
+
+__attribute__((noinline)) void *operator new( size_t Size )
+{
+    AllocationCount++;
+    void *Result = malloc( Size ? Size : 1 );
+    if( !Result )
+    {
+        throw std::bad_alloc();
+    }
+    return Result;
+}
+
+__attribute__((noinline)) void operator delete( void *Ptr ) noexcept
+{
+    free( Ptr );
+}
+
+__attribute__((noinline)) void operator delete( void *Ptr, size_t ) noexcept
+{
+    free( Ptr );
+}
+
+// Stop the optimiser from discarding benchmarked work.
+template<typename T>
+static inline void KeepAlive( const T &Value )
+{
+    asm volatile( "" : : "g"( &Value ) : "memory" );
+}
+
+// Types used by the benchmarks
+struct InterfaceType
+{
+    virtual ~InterfaceType()
+    {
+    }
+};
+
+struct Concretion : public InterfaceType
+{
+};
+
+// Deep dependency chain: Link<N> requires Link<N-1>
+template<int N>
+struct Link
+{
+    std::shared_ptr<Link<N - 1>> Next;
+
+    Link( std::shared_ptr<Link<N - 1>> NextIn ) : Next( NextIn )
+    {
+    }
+};
+
+template<>
+struct Link<0>
+{
+};
+
+static const int ChainDepth = 8;
+static const int LongChainDepth = 49;
+
+// Number of names registered for one type in the large registry
+static const size_t LargeRegistrySize = 10000;
+
+// Wide fan-out: Hub requires eight distinct leaves
+template<int N>
+struct Leaf
+{
+};
+
+struct Hub
+{
+    std::shared_ptr<Leaf<0>> L0;
+    std::shared_ptr<Leaf<1>> L1;
+    std::shared_ptr<Leaf<2>> L2;
+    std::shared_ptr<Leaf<3>> L3;
+    std::shared_ptr<Leaf<4>> L4;
+    std::shared_ptr<Leaf<5>> L5;
+    std::shared_ptr<Leaf<6>> L6;
+    std::shared_ptr<Leaf<7>> L7;
+
+    Hub( std::shared_ptr<Leaf<0>> L0In, std::shared_ptr<Leaf<1>> L1In,
+            std::shared_ptr<Leaf<2>> L2In, std::shared_ptr<Leaf<3>> L3In,
+            std::shared_ptr<Leaf<4>> L4In, std::shared_ptr<Leaf<5>> L5In,
+            std::shared_ptr<Leaf<6>> L6In, std::shared_ptr<Leaf<7>> L7In )
+        : L0( L0In ), L1( L1In ), L2( L2In ), L3( L3In ),
+        L4( L4In ), L5( L5In ), L6( L6In ), L7( L7In )
+    {
+    }
+};
+
+// Diamond: Top requires two Sides which both require a Bottom
+template<int N>
+struct Bottom
+{
+};
+
+template<int N>
+struct Side
+{
+    std::shared_ptr<Bottom<N>> Shared;
+
+    Side( std::shared_ptr<Bottom<N>> SharedIn ) : Shared( SharedIn )
+    {
+    }
+};
+
+template<int N>
+struct Top
+{
+    std::shared_ptr<Side<N>> Left;
+    std::shared_ptr<Side<N>> Right;
+
+    Top( std::shared_ptr<Side<N>> LeftIn, std::shared_ptr<Side<N>> RightIn )
+        : Left( LeftIn ), Right( RightIn )
+    {
+    }
+};
+
+template<int N>
+static void RegisterDiamond( ioc::container &Container )
+{
+    Container.register_type<Side<N>, Side<N>, Bottom<N>>();
+    Container.register_type<Top<N>, Top<N>, Side<N>, Side<N>>();
+}
+
+// Leaf shared through non-atomic local_ptrs
+struct LocalLeaf : public ioc::local_counted
+{
+};
+
+static Leaf<103> *CreateLeaf()
+{
+    return new Leaf<103>();
+}
+
+template<int N>
+struct RegisterChain
+{
+    static void Register( ioc::container &Container )
+    {
+        RegisterChain<N - 1>::Register( Container );
+        Container.register_type<Link<N>, Link<N>, Link<N - 1>>();
+    }
+};
+
+template<>
+struct RegisterChain<0>
+{
+    static void Register( ioc::container &Container )
+    {
+        Container.register_type<Link<0>, Link<0>>();
+    }
+};
+
+// Compile time bindings for the chain and the hand-written
+// construction they are compared against
+template<int N, typename ...bindings>
+struct StaticChain
+{
+    typedef typename StaticChain<N - 1, 
+            ioc::bind<Link<N>, Link<N>, Link<N - 1>>, bindings...>::type type;
+};
+
+template<typename ...bindings>
+struct StaticChain<0, bindings...>
+{
+    typedef ioc::static_container<ioc::bind<InterfaceType, Concretion>,
+            ioc::bind<Link<0>, Link<0>>, bindings...> type;
+};
+
+template<int N>
+struct BuildChain
+{
+    static std::shared_ptr<Link<N>> Build()
+    {
+        return std::make_shared<Link<N>>( BuildChain<N - 1>::Build() );
+    }
+};
+
+template<>
+struct BuildChain<0>
+{
+    static std::shared_ptr<Link<0>> Build()
+    {
+        return std::make_shared<Link<0>>();
+    }
+};
+
+static void RegisterHub( ioc::container &Container )
+{
+    Container.register_type<Leaf<0>, Leaf<0>>();
+    Container.register_type<Leaf<1>, Leaf<1>>();
+    Container.register_type<Leaf<2>, Leaf<2>>();
+    Container.register_type<Leaf<3>, Leaf<3>>();
+    Container.register_type<Leaf<4>, Leaf<4>>();
+    Container.register_type<Leaf<5>, Leaf<5>>();
+    Container.register_type<Leaf<6>, Leaf<6>>();
+    Container.register_type<Leaf<7>, Leaf<7>>();
+    Container.register_type<Hub, Hub, Leaf<0>, Leaf<1>, Leaf<2>, Leaf<3>,
+        Leaf<4>, Leaf<5>, Leaf<6>, Leaf<7>>();
+}
+
+// Benchmark harness. Each benchmark runs a number of samples, each
+// of a fixed batch of operations, and reports the spread of the
+// per-operation time across samples.
+static const size_t SampleCount = 200;
+static const size_t BatchSize = 1000;
+
+struct BenchmarkResult
+{
+    double Mean;
+    double P50;
+    double P90;
+    double P99;
+    double Allocations;
+};
+
+static void PrintHeader()
+{
+    std::cout << std::left << std::setw( 40 ) << "benchmark"
+        << std::right
+        << std::setw( 10 ) << "ns/op"
+        << std::setw( 10 ) << "p50"
+        << std::setw( 10 ) << "p90"
+        << std::setw( 10 ) << "p99"
+        << std::setw( 12 ) << "allocs/op" << std::endl;
+}
+
+static void PrintResult( const char *Name, const BenchmarkResult &Result )
+{
+    std::cout << std::left << std::setw( 40 ) << Name
+        << std::right << std::fixed << std::setprecision( 1 )
+        << std::setw( 10 ) << Result.Mean
+        << std::setw( 10 ) << Result.P50
+        << std::setw( 10 ) << Result.P90
+        << std::setw( 10 ) << Result.P99
+        << std::setw( 12 ) << std::setprecision( 2 ) << Result.Allocations
+        << std::endl;
+}
+
+template<typename F>
+static BenchmarkResult Measure( F Operation )
+{
+    typedef std::chrono::steady_clock clock;
+
+    // Warm up caches and any lazily built state
+    for( size_t i = 0; i < BatchSize; i++ )
+    {
+        Operation();
+    }
+
+    std::vector<double> Samples( SampleCount );
+    const size_t AllocationsBefore = AllocationCount;
+    for( size_t s = 0; s < SampleCount; s++ )
+    {
+        const clock::time_point Start = clock::now();
+        for( size_t i = 0; i < BatchSize; i++ )
+        {
+            Operation();
+        }
+        const clock::time_point End = clock::now();
+        Samples[s] = std::chrono::duration<double, std::nano>( End - Start ).count()
+            / BatchSize;
+    }
+    const size_t Allocations = AllocationCount - AllocationsBefore;
+
+    BenchmarkResult Result;
+    Result.Mean = 0;
+    for( size_t s = 0; s < SampleCount; s++ )
+    {
+        Result.Mean += Samples[s];
+    }
+    Result.Mean /= SampleCount;
+    std::sort( Samples.begin(), Samples.end() );
+    Result.P50 = Samples[SampleCount * 50 / 100];
+    Result.P90 = Samples[SampleCount * 90 / 100];
+    Result.P99 = Samples[SampleCount * 99 / 100];
+    Result.Allocations = static_cast<double>( Allocations ) /
+        ( SampleCount * BatchSize );
+    return Result;
+}
+
+// Per-name cost of interning Count distinct names into an empty
+// container. It stays flat as Count grows while interning is
+// linear overall.
+static BenchmarkResult MeasureIntern( size_t Count )
+{
+    typedef std::chrono::steady_clock clock;
+    static const size_t Repetitions = 5;
+
+    std::vector<std::string> Names( Count );
+    for( size_t i = 0; i < Count; i++ )
+    {
+        Names[i] = "Name" + std::to_string( i );
+    }
+
+    std::vector<double> Samples( Repetitions );
+    size_t Allocations = 0;
+    for( size_t s = 0; s < Repetitions; s++ )
+    {
+        ioc::container Container;
+        const size_t AllocationsBefore = AllocationCount;
+        const clock::time_point Start = clock::now();
+        for( size_t i = 0; i < Count; i++ )
+        {
+            KeepAlive( Container.intern_name( Names[i] ) );
+        }
+        const clock::time_point End = clock::now();
+        Allocations += AllocationCount - AllocationsBefore;
+        Samples[s] = std::chrono::duration<double, std::nano>( End - Start ).count()
+            / Count;
+    }
+
+    BenchmarkResult Result;
+    Result.Mean = 0;
+    for( size_t s = 0; s < Repetitions; s++ )
+    {
+        Result.Mean += Samples[s];
+    }
+    Result.Mean /= Repetitions;
+    std::sort( Samples.begin(), Samples.end() );
+    Result.P50 = Samples[Repetitions * 50 / 100];
+    Result.P90 = Samples[Repetitions * 90 / 100];
+    Result.P99 = Samples[Repetitions * 99 / 100];
+    Result.Allocations = static_cast<double>( Allocations ) /
+        ( Repetitions * Count );
+    return Result;
+}
+
+// Run Operation if Name matches the optional filter
+template<typename F>
+static void Run( const char *Filter, const char *Name, F Operation )
+{
+    if( !Filter || strstr( Name, Filter ) )
+    {
+        PrintResult( Name, Measure( Operation ) );
+    }
+}
+
+int main( int argc, char **argv )
+{
+    // An optional argument selects benchmarks whose name contains it
+    const char *Filter = argc > 1 ? argv[1] : NULL;
+
+    ioc::container Container;
+    Container.register_type<InterfaceType, Concretion>();
+    Container.register_type_with_name<InterfaceType, Concretion>( "Named" );
+    Container.register_instance<Concretion>( std::make_shared<Concretion>() );
+    RegisterChain<LongChainDepth>::Register( Container );
+    RegisterHub( Container );
+    Container.register_delegate<Leaf<103>, Leaf<103> *(*)()>( CreateLeaf );
+    Container.register_pooled<Leaf<104>, Leaf<104>>( 4 );
+    Container.register_type<LocalLeaf, LocalLeaf>();
+    Container.register_type<Bottom<0>, Bottom<0>>();
+    Container.register_per_graph<Bottom<1>, Bottom<1>>();
+    RegisterDiamond<0>( Container );
+    RegisterDiamond<1>( Container );
+    const std::string Name( "Named" );
+    const ioc::name_id NameId = Container.intern_name( Name );
+
+    // A registry of many names, looked up by a name from its middle
+    ioc::container Large;
+    for( size_t i = 0; i < LargeRegistrySize; i++ )
+    {
+        Large.register_type_with_name<InterfaceType, Concretion>( 
+                "Registration" + std::to_string( i ) );
+    }
+    const std::string LargeName( "Registration" + 
+            std::to_string( LargeRegistrySize / 2 ) );
+    const std::string LargeMiss( "Unregistered" );
+    const StaticChain<ChainDepth>::type Static;
+
+    PrintHeader();
+
+    Run( Filter, "register_type+remove_registration", [&Container]()
+            {
+                Container.register_type<Leaf<100>, Leaf<100>>();
+                Container.remove_registration<Leaf<100>>();
+            } );
+
+    Run( Filter, "register_delegate+remove_registration", [&Container]()
+            {
+                Container.register_delegate<Leaf<101>, Leaf<101> *(*)()>(
+                    []() { return new Leaf<101>(); } );
+                Container.remove_registration<Leaf<101>>();
+            } );
+
+    Run( Filter, "resolve", [&Container]()
+            {
+                KeepAlive( Container.resolve<InterfaceType>() );
+            } );
+
+    Run( Filter, "resolve_by_name", [&Container, &Name]()
+            {
+                KeepAlive( Container.resolve_by_name<InterfaceType>( Name ) );
+            } );
+
+    Run( Filter, "resolve_by_name literal", [&Container]()
+            {
+                KeepAlive( Container.resolve_by_name<InterfaceType>( "Named" ) );
+            } );
+
+    Run( Filter, "resolve_by_name name_id", [&Container, &NameId]()
+            {
+                KeepAlive( Container.resolve_by_name<InterfaceType>( NameId ) );
+            } );
+
+    Run( Filter, "resolve_by_name hashed literal", [&Container]()
+            {
+                using namespace ioc::literals;
+                KeepAlive( Container.resolve_by_name<InterfaceType>( "Named"_ioc ) );
+            } );
+
+    Run( Filter, "resolve_by_name (10k names)", [&Large, &LargeName]()
+            {
+                KeepAlive( Large.resolve_by_name<InterfaceType>( LargeName ) );
+            } );
+
+    Run( Filter, "resolve_by_name miss (10k names)", [&Large, &LargeMiss]()
+            {
+                KeepAlive( Large.resolve_by_name<InterfaceType>( LargeMiss ) );
+            } );
+
+    static const char *const InternNames[] = { "intern_name (10k names)",
+        "intern_name (40k names)", "intern_name (160k names)" };
+    for( size_t i = 0, Count = 10000; i < 3; i++, Count *= 4 )
+    {
+        if( !Filter || strstr( InternNames[i], Filter ) )
+        {
+            PrintResult( InternNames[i], MeasureIntern( Count ) );
+        }
+    }
+
+    ioc::container::handle<InterfaceType> Handle = 
+        Container.get_handle<InterfaceType>();
+    Run( Filter, "handle resolve", [&Handle]()
+            {
+                KeepAlive( Handle.resolve() );
+            } );
+
+    ioc::container::handle<InterfaceType> NamedHandle = 
+        Container.get_handle<InterfaceType>( NameId );
+    Run( Filter, "handle resolve named", [&NamedHandle]()
+            {
+                KeepAlive( NamedHandle.resolve() );
+            } );
+
+    Run( Filter, "resolve instance", [&Container]()
+            {
+                KeepAlive( Container.resolve<Concretion>() );
+            } );
+
+    Run( Filter, "resolve_ref instance", [&Container]()
+            {
+                KeepAlive( Container.resolve_ref<Concretion>() );
+            } );
+
+    Run( Filter, "resolve unregistered", [&Container]()
+            {
+                KeepAlive( Container.resolve<Leaf<102>>() );
+            } );
+
+    Run( Filter, "resolve delegate", [&Container]()
+            {
+                KeepAlive( Container.resolve<Leaf<103>>() );
+            } );
+
+    Run( Filter, "resolve pooled", [&Container]()
+            {
+                KeepAlive( Container.resolve<Leaf<104>>() );
+            } );
+
+    Run( Filter, "resolve deep chain (depth 8)", [&Container]()
+            {
+                KeepAlive( Container.resolve<Link<ChainDepth>>() );
+            } );
+
+    Run( Filter, "resolve 50-node graph", [&Container]()
+            {
+                KeepAlive( Container.resolve<Link<LongChainDepth>>() );
+            } );
+
+    Run( Filter, "resolve wide fan-out (8 deps)", [&Container]()
+            {
+                KeepAlive( Container.resolve<Hub>() );
+            } );
+
+    const std::shared_ptr<LocalLeaf> SharedLeaf = Container.resolve<LocalLeaf>();
+    Run( Filter, "copy shared_ptr", [&SharedLeaf]()
+            {
+                std::shared_ptr<LocalLeaf> Copy( SharedLeaf );
+                KeepAlive( Copy );
+            } );
+
+    const ioc::local_ptr<LocalLeaf> LocalPtr = Container.resolve<LocalLeaf>();
+    Run( Filter, "copy local_ptr", [&LocalPtr]()
+            {
+                ioc::local_ptr<LocalLeaf> Copy( LocalPtr );
+                KeepAlive( Copy );
+            } );
+
+    Run( Filter, "resolve diamond", [&Container]()
+            {
+                KeepAlive( Container.resolve<Top<0>>() );
+            } );
+
+    Run( Filter, "resolve diamond per-graph", [&Container]()
+            {
+                KeepAlive( Container.resolve<Top<1>>() );
+            } );
+
+    Run( Filter, "resolve hub and leaves separately", [&Container]()
+            {
+                KeepAlive( Container.resolve<Hub>() );
+                KeepAlive( Container.resolve<Leaf<0>>() );
+                KeepAlive( Container.resolve<Leaf<1>>() );
+                KeepAlive( Container.resolve<Leaf<2>>() );
+                KeepAlive( Container.resolve<Leaf<3>>() );
+            } );
+
+    Run( Filter, "resolve_all hub and leaves", [&Container]()
+            {
+                KeepAlive( Container.resolve_all<Hub, Leaf<0>, Leaf<1>, 
+                    Leaf<2>, Leaf<3>>() );
+            } );
+
+    Run( Filter, "hand-written make_shared", []()
+            {
+                std::shared_ptr<InterfaceType> Value = std::make_shared<Concretion>();
+                KeepAlive( Value );
+            } );
+
+    Run( Filter, "static_container resolve", [&Static]()
+            {
+                KeepAlive( Static.resolve<InterfaceType>() );
+            } );
+
+    Run( Filter, "hand-written chain (depth 8)", []()
+            {
+                KeepAlive( BuildChain<ChainDepth>::Build() );
+            } );
+
+    Run( Filter, "static_container chain (depth 8)", [&Static]()
+            {
+                KeepAlive( Static.resolve<Link<ChainDepth>>() );
+            } );
+
+    return 0;
+}
@@ -13,6 +13,9 @@
 #include <stdint.h>
 #include <memory>
 #include <cstring>
+#include <thread>
+#include <atomic>
+#include <chrono>
 
 // Possible status of tests
 enum TestStatus
@@ -90,10 +93,36 @@ static void PrintTestFailure( const TestFunctionObject &Obj )
 }
 
 
+// Counter to measure the number of heap allocations
+// made through the global operator new. The counters are
+// atomic as some tests resolve from several threads.
+static std::atomic<size_t> AllocationCount( 0 );
+
+void *operator new( size_t Size )
+{
+    AllocationCount++;
+    void *Result = malloc( Size ? Size : 1 );
+    if( !Result )
+    {
+        throw std::bad_alloc();
+    }
+    return Result;
+}
+
+void operator delete( void *Ptr ) noexcept
+{
+    free( Ptr );
+}
+
+void operator delete( void *Ptr, size_t ) noexcept
+{
+    free( Ptr );
+}
+
 // Counters to measure the number of
 // constructed and destructed types.
-static size_t ConstructedCount;
-static size_t DestructedCount;
+static std::atomic<size_t> ConstructedCount( 0 );
+static std::atomic<size_t> DestructedCount( 0 );
 
 static void ResetCounters()
 {
@@ -567,6 +596,1413 @@ static TestStatus TestRegisterDelegateWithName()
     return Result;
 }
 
+// Register and remove enough named registrations to force the
+// registration tables to grow and to shuffle entries on removal.
+static TestStatus TestManyNamedRegistrations()
+{
+    TestStatus Result = TS_Registration_Error;
+    ioc::container container;
+    try
+    {
+        const size_t count = 64;
+        for( size_t i = 0; i < count; i++ )
+        {
+            container.register_type_with_name<Concretion, Concretion>( 
+                    "Name" + std::to_string( i ) );
+        }
+        // Remove every other registration
+        for( size_t i = 0; i < count; i += 2 )
+        {
+            container.remove_registration_by_name<Concretion>( 
+                    "Name" + std::to_string( i ) );
+        }
+        Result = TS_Resolution_Error;
+        size_t found = 0;
+        for( size_t i = 0; i < count; i++ )
+        {
+            const bool registered = container.type_is_registered<Concretion>( 
+                    "Name" + std::to_string( i ) );
+            if( registered == ( i % 2 == 1 ) )
+            {
+                found++;
+            }
+        }
+        // Removing the last name removes the type altogether
+        for( size_t i = 1; i < count; i += 2 )
+        {
+            container.remove_registration_by_name<Concretion>( 
+                    "Name" + std::to_string( i ) );
+        }
+        if( found == count && !container.type_is_registered<Concretion>() )
+        {
+            Result = TS_Success;
+        }
+    }
+    catch( const std::exception &e )
+    {
+        PrintException( __func__, e );
+    }
+
+    return Result;
+}
+
+// Unnamed lookups go straight to the default registration for a
+// type, so they must not allocate however many named registrations
+// sit alongside it.
+static TestStatus TestUnnamedLookupDoesNotAllocate()
+{
+    TestStatus Result = TS_Registration_Error;
+    ioc::container container;
+    try
+    {
+        container.register_type<InterfaceType, Concretion>();
+        for( size_t i = 0; i < 32; i++ )
+        {
+            container.register_type_with_name<InterfaceType, Concretion>( 
+                    "Name" + std::to_string( i ) );
+        }
+        Result = TS_Resolution_Error;
+
+        const size_t iterations = 1000;
+        const size_t before = AllocationCount;
+        size_t found = 0;
+        for( size_t i = 0; i < iterations; i++ )
+        {
+            if( container.type_is_registered<InterfaceType>() )
+            {
+                found++;
+            }
+        }
+        const size_t allocations = AllocationCount - before;
+        std::cout << "Allocations per unnamed lookup: " 
+            << static_cast<double>( allocations ) / iterations << std::endl;
+
+        // Removing the default must promote the next lowest name
+        container.remove_registration_by_name<InterfaceType>( "Name0" );
+        std::shared_ptr<InterfaceType> Inst = container.resolve<InterfaceType>();
+        if( found == iterations && allocations == 0 && Inst.get() )
+        {
+            Result = TS_Success;
+        }
+    }
+    catch( const std::exception &e )
+    {
+        PrintException( __func__, e );
+    }
+
+    return Result;
+}
+
+// Named lookups from string literals must not build a temporary
+// std::string, before or after the container is frozen.
+static TestStatus TestNamedLookupDoesNotAllocate()
+{
+    TestStatus Result = TS_Registration_Error;
+    ioc::container container;
+    try
+    {
+        std::shared_ptr<InterfaceType> Instance( new Concretion() );
+        container.register_instance_with_name<InterfaceType>( 
+                "a registration name too long for small string storage", Instance );
+        Result = TS_Resolution_Error;
+
+        const size_t iterations = 1000;
+        size_t found = 0;
+        size_t allocations = 0;
+        for( size_t pass = 0; pass < 2; pass++ )
+        {
+            const size_t before = AllocationCount;
+            for( size_t i = 0; i < iterations; i++ )
+            {
+                if( container.type_is_registered<InterfaceType>( 
+                            "a registration name too long for small string storage" ) &&
+                        container.resolve_by_name<InterfaceType>( 
+                            "a registration name too long for small string storage" ) == Instance &&
+                        !container.resolve_by_name<InterfaceType>( "missing" ).get() )
+                {
+                    found++;
+                }
+            }
+            allocations += AllocationCount - before;
+            container.freeze();
+        }
+        std::cout << "Allocations per named lookup: " 
+            << static_cast<double>( allocations ) / ( 2 * iterations ) << std::endl;
+        if( found == 2 * iterations && allocations == 0 )
+        {
+            Result = TS_Success;
+        }
+    }
+    catch( const std::exception &e )
+    {
+        PrintException( __func__, e );
+    }
+
+    return Result;
+}
+
+// Names interned at registration, or ahead of it, resolve through
+// their handle before and after the container is frozen.
+static TestStatus TestNameIds()
+{
+    TestStatus Result = TS_Registration_Error;
+    ioc::container Container;
+    try
+    {
+        const ioc::name_id Early = Container.intern_name( "Replica" );
+        const ioc::name_id Primary = 
+            Container.register_type_with_name<InterfaceType, Concretion>( "Primary" );
+        const ioc::name_id Replica = 
+            Container.register_type_with_name<InterfaceType, Concretion>( "Replica" );
+        const ioc::name_id Unused = Container.intern_name( "Unused" );
+        Result = TS_Resolution_Error;
+
+        bool Success = Early == Replica && Primary != Replica && 
+            Primary.is_valid() && !ioc::name_id().is_valid() &&
+            Container.intern_name( std::string( "Primary" ) ) == Primary;
+        for( size_t pass = 0; pass < 2; pass++ )
+        {
+            Success = Success &&
+                Container.resolve_by_name<InterfaceType>( Primary ).get() &&
+                Container.resolve_by_name<InterfaceType>( Replica ).get() &&
+                Container.type_is_registered<InterfaceType>( Replica ) &&
+                !Container.resolve_by_name<InterfaceType>( Unused ).get() &&
+                !Container.resolve_by_name<InterfaceType>( ioc::name_id() ).get();
+            Container.freeze();
+        }
+        Success = Success && !Container.intern_name( "Unseen" ).is_valid() &&
+            Container.intern_name( "Replica" ) == Replica;
+
+        if( Success )
+        {
+            Result = TS_Success;
+        }
+    }
+    catch( const std::exception &e )
+    {
+        PrintException( __func__, e );
+    }
+
+    return Result;
+}
+
+// Hashed name literals match the runtime hash of the same name
+// and resolve with no string handling at all.
+static TestStatus TestHashedNames()
+{
+    using namespace ioc::literals;
+    static_assert( "Replica"_ioc.get() != "Primary"_ioc.get(), 
+            "Hashed names must be computed at compile time" );
+
+    TestStatus Result = TS_Registration_Error;
+    ioc::container Container;
+    try
+    {
+        Container.register_type_with_name<InterfaceType, Concretion>( "Primary" );
+        Container.register_type_with_name<InterfaceType, Concretion>( "Replica" );
+        Result = TS_Resolution_Error;
+
+        bool Success = "Replica"_ioc.get() == ioc::hash_name( "Replica" );
+        for( size_t pass = 0; pass < 2; pass++ )
+        {
+            const size_t Before = AllocationCount;
+            const bool Found = 
+                Container.type_is_registered<InterfaceType>( "Replica"_ioc ) &&
+                !Container.type_is_registered<InterfaceType>( "Unused"_ioc ) &&
+                !Container.resolve_by_name<Concretion>( "Replica"_ioc ).get();
+            Success = Success && Found && AllocationCount == Before &&
+                Container.resolve_by_name<InterfaceType>( "Primary"_ioc ).get();
+            Container.freeze();
+        }
+
+        if( Success )
+        {
+            Result = TS_Success;
+        }
+    }
+    catch( const std::exception &e )
+    {
+        PrintException( __func__, e );
+    }
+
+    return Result;
+}
+
+// Handles follow registration changes and otherwise
+// resolve without a lookup.
+static TestStatus TestHandles()
+{
+    TestStatus Result = TS_Registration_Error;
+    ioc::container Container;
+    try
+    {
+        ioc::container::handle<InterfaceType> Default = 
+            Container.get_handle<InterfaceType>();
+        ioc::container::handle<InterfaceType> Named = 
+            Container.get_handle<InterfaceType>( "Named" );
+        const bool EmptyBefore = !Default.resolve().get() && !Named.resolve().get();
+
+        Container.register_type<InterfaceType, Concretion>();
+        Container.register_type_with_name<InterfaceType, Concretion>( "Named" );
+        Result = TS_Resolution_Error;
+
+        const size_t Before = AllocationCount;
+        const size_t Iterations = 100;
+        size_t Resolved = 0;
+        for( size_t i = 0; i < Iterations; i++ )
+        {
+            if( Default.resolve().get() && Named.resolve().get() )
+            {
+                Resolved++;
+            }
+        }
+        const size_t Allocations = AllocationCount - Before;
+
+        Container.remove_registration_by_name<InterfaceType>( "Named" );
+        std::shared_ptr<Concretion> Instance( new Concretion() );
+        Container.remove_registration<InterfaceType>();
+        Container.register_instance<InterfaceType>( Instance );
+
+        if( EmptyBefore && Resolved == Iterations && 
+                Allocations == 2 * Iterations &&
+                Default.resolve() == Instance && !Named.resolve().get() )
+        {
+            Result = TS_Success;
+        }
+    }
+    catch( const std::exception &e )
+    {
+        PrintException( __func__, e );
+    }
+
+    return Result;
+}
+
+// Memory resource which counts the bytes outstanding
+// from it and forwards to the default resource. The counts
+// may be read while a concurrent container reclaims.
+class CountingResource : public ioc::memory_resource
+{
+    public:
+        std::atomic<size_t> Outstanding;
+        std::atomic<size_t> Allocations;
+
+        CountingResource() : Outstanding( 0 ), Allocations( 0 )
+        {
+        }
+
+    private:
+        void *do_allocate( size_t Bytes, size_t Alignment )
+        {
+            Outstanding += Bytes;
+            Allocations++;
+            return ioc::new_delete_resource()->allocate( Bytes, Alignment );
+        }
+
+        void do_deallocate( void *Ptr, size_t Bytes, size_t Alignment )
+        {
+            Outstanding -= Bytes;
+            ioc::new_delete_resource()->deallocate( Ptr, Bytes, Alignment );
+        }
+
+        bool do_is_equal( const ioc::memory_resource &Other ) const noexcept
+        {
+            return this == &Other;
+        }
+};
+
+// Check that a container allocates its registrations and
+// factories from the resource it was given and releases them
+// all, and that products can come from a separate resource.
+static TestStatus TestMemoryResource()
+{
+    TestStatus Result = TS_Registration_Error;
+    CountingResource Structures;
+    CountingResource Products;
+    try
+    {
+        size_t Used = 0;
+        std::shared_ptr<InterfaceType> Product;
+        {
+            ioc::container Container( Structures );
+            Container.register_type<InterfaceType, Concretion>( Products );
+            Container.register_type_with_name<InterfaceType, Concretion>( "Named" );
+            Container.remove_registration_by_name<InterfaceType>( "Named" );
+            Used = Structures.Outstanding;
+            Result = TS_Resolution_Error;
+            Product = Container.resolve<InterfaceType>();
+        }
+
+        if( Used > 0 && Structures.Outstanding == 0 && Product.get() &&
+                Products.Allocations == 1 && Products.Outstanding > 0 )
+        {
+            Product.reset();
+            if( Products.Outstanding == 0 )
+            {
+                Result = TS_Success;
+            }
+        }
+    }
+    catch( const std::exception &e )
+    {
+        PrintException( __func__, e );
+    }
+
+    return Result;
+}
+
+// Delegate which keeps its resolving thread inside the container
+// for a while.
+static InterfaceType *CreateSlowly()
+{
+    std::this_thread::sleep_for( std::chrono::microseconds( 200 ) );
+    return new Concretion();
+}
+
+// A concurrent container which is resolved from several threads
+// without pause must still free the registrations and factories it
+// replaces while those threads keep resolving. The readers spend
+// nearly all their time in a resolution so there is hardly ever a
+// moment when none of them is reading.
+static TestStatus TestReclaimWhileResolving()
+{
+    TestStatus Result = TS_Registration_Error;
+    CountingResource Structures;
+    try
+    {
+        ioc::container Container( Structures, ioc::container::concurrent );
+        Container.register_delegate<InterfaceType>( CreateSlowly );
+        const size_t Baseline = Structures.Outstanding;
+        Container.register_type<Concretion, Concretion>();
+        // Roughly what each cycle below retires
+        const size_t Footprint = Structures.Outstanding - Baseline;
+        Container.remove_registration<Concretion>();
+        Result = TS_Resolution_Error;
+
+        std::atomic<bool> Done( false );
+        std::vector<std::thread> Readers;
+        for( size_t i = 0; i < 4; i++ )
+        {
+            Readers.push_back( std::thread( [&Container, &Done]()
+                        {
+                            while( !Done.load() )
+                            {
+                                Container.resolve<InterfaceType>();
+                            }
+                        } ) );
+        }
+
+        const size_t Cycles = 2000;
+        for( size_t i = 0; i < Cycles; i++ )
+        {
+            Container.register_type<Concretion, Concretion>();
+            Container.remove_registration<Concretion>();
+        }
+        const size_t Retained = Structures.Outstanding - Baseline;
+
+        // Writes after the readers have moved on let the container
+        // free what the earlier ones retired, leaving only the last
+        // few cycles.
+        bool Reclaimed = false;
+        for( size_t i = 0; i < 1000 && !Reclaimed; i++ )
+        {
+            std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+            Container.register_type<Concretion, Concretion>();
+            Container.remove_registration<Concretion>();
+            Reclaimed = Structures.Outstanding < Baseline + 16 * Footprint;
+        }
+        Done = true;
+        for( size_t i = 0; i < Readers.size(); i++ )
+        {
+            Readers[i].join();
+        }
+
+        std::cout << "Bytes retained after " << Cycles << " cycles: " 
+            << Retained << std::endl;
+        if( Reclaimed )
+        {
+            Result = TS_Success;
+        }
+    }
+    catch( const std::exception &e )
+    {
+        PrintException( __func__, e );
+    }
+
+    return Result;
+}
+
+static size_t ResetCount = 0;
+
+static void ResetConcretion( Concretion & )
+{
+    ResetCount++;
+}
+
+// Check that a pooled registration hands released objects out
+// again after resetting them, falls back to plain construction
+// when the pool is exhausted and destroys everything in the end.
+static TestStatus TestPooledRegistration()
+{
+    TestStatus Result = TS_Registration_Error;
+    ResetCounters();
+    ResetCount = 0;
+    try
+    {
+        bool Reused = false;
+        size_t Allocations = 0;
+        ioc::pool_stats Stats = ioc::pool_stats();
+        {
+            ioc::container Container;
+            Container.register_pooled<InterfaceType, Concretion>( 2, ResetConcretion );
+            Result = TS_Resolution_Error;
+
+            std::shared_ptr<InterfaceType> First = Container.resolve<InterfaceType>();
+            const InterfaceType *Raw = First.get();
+            First.reset();
+            const size_t Before = AllocationCount;
+            First = Container.resolve<InterfaceType>();
+            Allocations = AllocationCount - Before;
+            Reused = First.get() == Raw && ResetCount == 1 && ConstructedCount == 1;
+
+            std::shared_ptr<InterfaceType> Second = Container.resolve<InterfaceType>();
+            std::shared_ptr<InterfaceType> Overflow = Container.resolve<InterfaceType>();
+            Stats = Container.get_pool_stats<InterfaceType>();
+
+            // Objects still held when the registration goes
+            // are destroyed as they are released.
+            Container.remove_registration<InterfaceType>();
+            Second.reset();
+            Overflow.reset();
+        }
+
+        if( Reused && Allocations == 0 && Stats.capacity == 2 &&
+                Stats.hits == 1 && Stats.misses == 3 && 
+                Stats.high_water_mark == 2 &&
+                ConstructedCount == 3 && DestructedCount == 3 )
+        {
+            Result = TS_Success;
+        }
+    }
+    catch( const std::exception &e )
+    {
+        PrintException( __func__, e );
+    }
+
+    return Result;
+}
+
+// Types shared through non-atomic local_ptrs
+struct LocalConcretion : public Concretion, public ioc::local_counted
+{
+};
+
+struct LocalClient
+{
+    ioc::local_ptr<LocalConcretion> Service;
+
+    LocalClient( ioc::local_ptr<LocalConcretion> ServiceIn )
+        : Service( ServiceIn )
+    {
+    }
+};
+
+// Check that a local_counted dependency can be injected as a
+// local_ptr, that copies are counted locally and that the object
+// is destroyed with its last local_ptr.
+static TestStatus TestLocalPointers()
+{
+    TestStatus Result = TS_Registration_Error;
+    ResetCounters();
+    try
+    {
+        ioc::container Container;
+        Container.register_type<LocalConcretion, LocalConcretion>();
+        Container.register_type<LocalClient, LocalClient, LocalConcretion>();
+        Result = TS_Resolution_Error;
+
+        std::shared_ptr<LocalClient> Client = Container.resolve<LocalClient>();
+        ioc::local_ptr<Concretion> Copy = Client->Service;
+        const bool Shared = Copy.get() == Client->Service.get() && 
+            Copy.use_count() == 2;
+        Client.reset();
+        const bool KeptAlive = DestructedCount == 0 && Copy.use_count() == 1;
+        Copy.reset();
+
+        if( Shared && KeptAlive && !Copy && 
+                ConstructedCount == 1 && DestructedCount == 1 )
+        {
+            Result = TS_Success;
+        }
+    }
+    catch( const std::exception &e )
+    {
+        PrintException( __func__, e );
+    }
+
+    return Result;
+}
+
+// Check that instances and singletons can be borrowed without
+// a reference and that transient registrations lend nothing.
+static TestStatus TestResolveRef()
+{
+    using namespace ioc::literals;
+    TestStatus Result = TS_Registration_Error;
+    ioc::container Container;
+    try
+    {
+        std::shared_ptr<Concretion> Instance( new Concretion() );
+        Container.register_instance<Concretion>( Instance );
+        const ioc::name_id SingleId = 
+            Container.register_singleton_with_name<InterfaceType, Concretion>( "Single" );
+        const ioc::name_id TransientId = 
+            Container.register_type_with_name<InterfaceType, Concretion>( "Transient" );
+        Result = TS_Resolution_Error;
+
+        const InterfaceType *Single = Container.resolve_ref<InterfaceType>( "Single" );
+        if( Container.resolve_ref<Concretion>() == Instance.get() && 
+                Instance.use_count() == 2 && Single &&
+                Single == Container.resolve_by_name<InterfaceType>( "Single" ).get() &&
+                Single == Container.resolve_ref<InterfaceType>( SingleId ) &&
+                Single == Container.resolve_ref<InterfaceType>( "Single"_ioc ) &&
+                !Container.resolve_ref<InterfaceType>( "Transient" ) &&
+                !Container.resolve_ref<InterfaceType>( TransientId ) &&
+                !Container.resolve_ref<InterfaceType>( "Transient"_ioc ) &&
+                !Container.resolve_ref<CompositeType>() )
+        {
+            Result = TS_Success;
+        }
+    }
+    catch( const std::exception &e )
+    {
+        PrintException( __func__, e );
+    }
+
+    return Result;
+}
+
+// Records how many references to its dependency
+// existed once it had been constructed.
+struct MovedInto
+{
+    std::shared_ptr<Concretion> Dependency;
+    long UseCount;
+
+    MovedInto( std::shared_ptr<Concretion> DependencyIn )
+        : Dependency( std::move( DependencyIn ) ), UseCount( Dependency.use_count() )
+    {
+    }
+};
+
+static MovedInto *CreateMovedInto( std::shared_ptr<Concretion> Dependency )
+{
+    return new MovedInto( std::move( Dependency ) );
+}
+
+// Check that the container hands each transient dependency on
+// to its constructor without keeping or copying a reference.
+static TestStatus TestDependenciesAreMovedIntoConstructors()
+{
+    TestStatus Result = TS_Registration_Error;
+    ioc::container Container;
+    try
+    {
+        Container.register_type<Concretion, Concretion>();
+        Container.register_type<MovedInto, MovedInto, Concretion>();
+        Container.register_singleton_with_name<MovedInto, MovedInto, Concretion>( "Singleton" );
+        Container.register_delegate_with_name<MovedInto, 
+            MovedInto *(*)( std::shared_ptr<Concretion> ), Concretion>( 
+                    "Delegate", CreateMovedInto );
+        Result = TS_Resolution_Error;
+
+        if( Container.resolve<MovedInto>()->UseCount == 1 &&
+                Container.resolve_by_name<MovedInto>( "Singleton" )->UseCount == 1 &&
+                Container.resolve_by_name<MovedInto>( "Delegate" )->UseCount == 1 )
+        {
+            Result = TS_Success;
+        }
+    }
+    catch( const std::exception &e )
+    {
+        PrintException( __func__, e );
+    }
+
+    return Result;
+}
+
+// Check that a batch shares each registration between everything
+// in it which needs it and that resolutions after it do not.
+static TestStatus TestResolveAll()
+{
+    TestStatus Result = TS_Registration_Error;
+    ioc::container Container;
+    try
+    {
+        Container.register_type<Concretion, Concretion>();
+        Container.register_type<InterfaceType, Concretion>();
+        Container.register_type<ComplexConcretion, ComplexConcretion, Concretion>();
+        Container.register_type<CompositeType, CompositeType, 
+            Concretion, InterfaceType, Concretion>();
+        Result = TS_Resolution_Error;
+
+        std::tuple<std::shared_ptr<CompositeType>, std::shared_ptr<ComplexConcretion>,
+            std::shared_ptr<CompositeType>, std::shared_ptr<ThrowingConcretion>> Batch = 
+                Container.resolve_all<CompositeType, ComplexConcretion, 
+                CompositeType, ThrowingConcretion>();
+        const std::shared_ptr<CompositeType> &Composite = std::get<0>( Batch );
+        const std::shared_ptr<ComplexConcretion> &Complex = std::get<1>( Batch );
+        const std::shared_ptr<CompositeType> After = Container.resolve<CompositeType>();
+
+        if( Composite && Complex && Composite == std::get<2>( Batch ) && 
+                !std::get<3>( Batch ) &&
+                Composite->Concrete1 == Composite->Concrete2 &&
+                Composite->Concrete1 == Complex->InnerInstance &&
+                Composite->Interface != Composite->Concrete1 &&
+                After->Concrete1 != After->Concrete2 )
+        {
+            Result = TS_Success;
+        }
+    }
+    catch( const std::exception &e )
+    {
+        PrintException( __func__, e );
+    }
+
+    return Result;
+}
+
+// Delegate which builds a composite from objects it resolves
+// itself, each as a resolution of its own.
+struct ResolveOwnDependencies
+{
+    ioc::container *Owner;
+
+    CompositeType *operator()() const
+    {
+        return new CompositeType( Owner->resolve<Concretion>(), 
+                Owner->resolve<InterfaceType>(), Owner->resolve<Concretion>() );
+    }
+};
+
+// Check that resolutions a delegate starts during a batch are not
+// part of it, that pooled registrations are shared in a batch and
+// that a batch follows a change of registration.
+static TestStatus TestResolveAllKeepsOtherResolutionsApart()
+{
+    TestStatus Result = TS_Registration_Error;
+    ioc::container Container;
+    try
+    {
+        const ResolveOwnDependencies Delegate = { &Container };
+        Container.register_type<Concretion, Concretion>();
+        Container.register_type<InterfaceType, Concretion>();
+        Container.register_delegate<CompositeType, ResolveOwnDependencies>( Delegate );
+        Container.register_pooled<ComplexConcretion, ComplexConcretion, Concretion>( 2 );
+        Result = TS_Resolution_Error;
+
+        std::tuple<std::shared_ptr<CompositeType>, std::shared_ptr<Concretion>,
+            std::shared_ptr<ComplexConcretion>, std::shared_ptr<ComplexConcretion>> Batch = 
+                Container.resolve_all<CompositeType, Concretion, 
+                ComplexConcretion, ComplexConcretion>();
+        const std::shared_ptr<CompositeType> &Composite = std::get<0>( Batch );
+        const bool Apart = Composite && 
+            Composite->Concrete1 != Composite->Concrete2 &&
+            Composite->Concrete1 != std::get<1>( Batch );
+        const bool PoolShared = std::get<2>( Batch ) && 
+            std::get<2>( Batch ) == std::get<3>( Batch );
+
+        Container.remove_registration<InterfaceType>();
+        Container.register_type<InterfaceType, ComplexConcretion, Concretion>();
+        std::tuple<std::shared_ptr<InterfaceType>, std::shared_ptr<Concretion>> Changed = 
+            Container.resolve_all<InterfaceType, Concretion>();
+        const ComplexConcretion *Complex = 
+            dynamic_cast<const ComplexConcretion *>( std::get<0>( Changed ).get() );
+
+        if( Apart && PoolShared && Complex && 
+                Complex->InnerInstance == std::get<1>( Changed ) )
+        {
+            Result = TS_Success;
+        }
+    }
+    catch( const std::exception &e )
+    {
+        PrintException( __func__, e );
+    }
+
+    return Result;
+}
+
+// Check that a per-graph registration is constructed once for
+// each resolution and shared within it.
+static TestStatus TestPerGraphRegistration()
+{
+    TestStatus Result = TS_Registration_Error;
+    ioc::container Container;
+    try
+    {
+        Container.register_per_graph<Concretion, Concretion>();
+        Container.register_type<InterfaceType, ComplexConcretion, Concretion>();
+        Container.register_type<CompositeType, CompositeType, 
+            Concretion, InterfaceType, Concretion>();
+        Result = TS_Resolution_Error;
+
+        std::shared_ptr<CompositeType> First = Container.resolve<CompositeType>();
+        std::shared_ptr<CompositeType> Second = Container.resolve<CompositeType>();
+        std::shared_ptr<ComplexConcretion> Complex = 
+            std::dynamic_pointer_cast<ComplexConcretion>( First->Interface );
+
+        if( First->Concrete1 == First->Concrete2 && Complex &&
+                Complex->InnerInstance == First->Concrete1 &&
+                Second->Concrete1 != First->Concrete1 &&
+                Container.resolve<Concretion>() != Container.resolve<Concretion>() )
+        {
+            Result = TS_Success;
+        }
+    }
+    catch( const std::exception &e )
+    {
+        PrintException( __func__, e );
+    }
+
+    return Result;
+}
+
+// Check that a per-graph registration is shared within the graph
+// of a singleton, pooled or scoped object as it is constructed.
+static TestStatus TestPerGraphUnderSharedLifetimes()
+{
+    TestStatus Result = TS_Registration_Error;
+    ioc::container Container;
+    try
+    {
+        Container.register_per_graph<Concretion, Concretion>();
+        Container.register_type<InterfaceType, ComplexConcretion, Concretion>();
+        Container.register_singleton_with_name<CompositeType, CompositeType, 
+            Concretion, InterfaceType, Concretion>( "Singleton" );
+        Container.register_pooled_with_name<CompositeType, CompositeType, 
+            Concretion, InterfaceType, Concretion>( "Pooled", 2 );
+        Container.register_scoped_with_name<CompositeType, CompositeType, 
+            Concretion, InterfaceType, Concretion>( "Scoped" );
+        Result = TS_Resolution_Error;
+
+        std::shared_ptr<CompositeType> Composites[3];
+        Composites[0] = Container.resolve_by_name<CompositeType>( "Singleton" );
+        Composites[1] = Container.resolve_by_name<CompositeType>( "Pooled" );
+        ioc::container::scope Scope( Container );
+        Composites[2] = Scope.resolve_by_name<CompositeType>( "Scoped" );
+
+        size_t Shared = 0;
+        for( size_t i = 0; i < 3; i++ )
+        {
+            const ComplexConcretion *Complex = Composites[i].get() ?
+                dynamic_cast<const ComplexConcretion *>( Composites[i]->Interface.get() ) : NULL;
+            if( Complex && Composites[i]->Concrete1 == Composites[i]->Concrete2 &&
+                    Complex->InnerInstance == Composites[i]->Concrete1 )
+            {
+                Shared++;
+            }
+        }
+        if( Shared == 3 && Composites[0]->Concrete1 != Composites[1]->Concrete1 )
+        {
+            Result = TS_Success;
+        }
+    }
+    catch( const std::exception &e )
+    {
+        PrintException( __func__, e );
+    }
+
+    return Result;
+}
+
+// Type slots are shared by every container so check that two
+// containers keep their registrations apart and that a removed
+// type can be registered again.
+static TestStatus TestRegistrationsAreIsolatedPerContainer()
+{
+    TestStatus Result = TS_Registration_Error;
+    ioc::container First;
+    ioc::container Second;
+    try
+    {
+        First.register_type<InterfaceType, Concretion>();
+        Second.register_type<Concretion, Concretion>();
+        First.remove_registration<InterfaceType>();
+        First.register_type_with_name<InterfaceType, Concretion>( "ThisName" );
+        Result = TS_Resolution_Error;
+
+        if( !Second.type_is_registered<InterfaceType>() &&
+                !First.type_is_registered<Concretion>() &&
+                First.resolve<InterfaceType>().get() &&
+                Second.resolve<Concretion>().get() )
+        {
+            Result = TS_Success;
+        }
+    }
+    catch( const std::exception &e )
+    {
+        PrintException( __func__, e );
+    }
+
+    return Result;
+}
+
+// Singletons are only constructed when first resolved and every
+// resolution, from any thread, shares the same instance.
+static TestStatus TestRegisterSingleton()
+{
+    TestStatus Result = TS_Registration_Error;
+    ioc::container Container;
+    try
+    {
+        Container.register_type<Concretion, Concretion>();
+        Container.register_singleton<ComplexConcretion, 
+            ComplexConcretion, Concretion>();
+        // Nothing is built until the first resolution
+        if( ConstructedCount == 0 )
+        {
+            Result = TS_Resolution_Error;
+
+            const size_t ThreadCount = 8;
+            std::vector<std::shared_ptr<ComplexConcretion>> Resolved( ThreadCount );
+            std::vector<std::thread> Threads;
+            for( size_t i = 0; i < ThreadCount; i++ )
+            {
+                Threads.push_back( std::thread( [&Container, &Resolved, i]()
+                            {
+                                Resolved[i] = Container.resolve<ComplexConcretion>();
+                            } ) );
+            }
+            for( size_t i = 0; i < ThreadCount; i++ )
+            {
+                Threads[i].join();
+            }
+
+            bool Same = Resolved[0].get() != NULL;
+            for( size_t i = 1; i < ThreadCount; i++ )
+            {
+                Same = Same && Resolved[i] == Resolved[0];
+            }
+            // One ComplexConcretion plus its inner Concretion
+            if( Same && ConstructedCount == 2 )
+            {
+                Result = TS_Success;
+            }
+        }
+    }
+    catch( const std::exception &e )
+    {
+        PrintException( __func__, e );
+    }
+
+    return Result;
+}
+
+// Scoped registrations are shared within a scope, built from the
+// scope's arena without touching the heap and destroyed when the
+// scope ends.
+static TestStatus TestRegisterScoped()
+{
+    TestStatus Result = TS_Registration_Error;
+    ioc::container Container;
+    try
+    {
+        Container.register_scoped<Concretion, Concretion>();
+        Container.register_scoped<ComplexConcretion, 
+            ComplexConcretion, Concretion>();
+        Result = TS_Resolution_Error;
+
+        // Scoped types only resolve within a scope
+        if( !Container.resolve<Concretion>().get() )
+        {
+            bool Shared = false;
+            size_t Allocations = 0;
+            {
+                ioc::container::scope Scope( Container );
+                const size_t Before = AllocationCount;
+                std::shared_ptr<ComplexConcretion> First = 
+                    Scope.resolve<ComplexConcretion>();
+                std::shared_ptr<ComplexConcretion> Second = 
+                    Scope.resolve<ComplexConcretion>();
+                std::shared_ptr<Concretion> Inner = Scope.resolve<Concretion>();
+                Allocations = AllocationCount - Before;
+                Shared = First.get() && First == Second && 
+                    First->InnerInstance == Inner;
+            }
+
+            std::cout << "Allocations within scope: " << Allocations << std::endl;
+            if( Shared && Allocations == 0 && 
+                    ConstructedCount == 2 && DestructedCount == 2 )
+            {
+                Result = TS_Success;
+            }
+        }
+    }
+    catch( const std::exception &e )
+    {
+        PrintException( __func__, e );
+    }
+
+    return Result;
+}
+
+// A scope which ends while a transient resolved from it still holds
+// one of its scoped objects leaves that object alive until the
+// transient releases it. An object only held weakly is destroyed
+// with the scope, and its weak_ptr can still be checked afterwards.
+static TestStatus TestScopeEndingWithOutstandingReference()
+{
+    TestStatus Result = TS_Registration_Error;
+    ioc::container Container;
+    try
+    {
+        Container.register_scoped<Concretion, Concretion>();
+        Container.register_scoped<InterfaceType, Concretion>();
+        Container.register_type<ComplexConcretion, 
+            ComplexConcretion, Concretion>();
+        Result = TS_Resolution_Error;
+
+        std::shared_ptr<ComplexConcretion> Outstanding;
+        std::weak_ptr<InterfaceType> Weak;
+        {
+            ioc::container::scope Scope( Container );
+            Outstanding = Scope.resolve<ComplexConcretion>();
+            Weak = Scope.resolve<InterfaceType>();
+        }
+
+        const bool Expired = Weak.expired();
+        const bool Alive = Outstanding.get() && 
+            Outstanding->InnerInstance->Success();
+        const size_t DestructedAtScopeEnd = DestructedCount;
+        Outstanding.reset();
+        if( Expired && Alive && ConstructedCount == 3 && 
+                DestructedAtScopeEnd == 1 && DestructedCount == 3 )
+        {
+            Result = TS_Success;
+        }
+    }
+    catch( const std::exception &e )
+    {
+        PrintException( __func__, e );
+    }
+
+    return Result;
+}
+
+// Resolving a registered type creates the object and its
+// reference count in a single allocation.
+static TestStatus TestResolveAllocatesOnce()
+{
+    TestStatus Result = TS_Registration_Error;
+    ioc::container Container;
+    try
+    {
+        Container.register_type<InterfaceType, Concretion>();
+        Result = TS_Resolution_Error;
+
+        const size_t Iterations = 100;
+        const size_t Before = AllocationCount;
+        size_t Resolved = 0;
+        for( size_t i = 0; i < Iterations; i++ )
+        {
+            std::shared_ptr<InterfaceType> Inst = Container.resolve<InterfaceType>();
+            if( Inst.get() && Inst->Success() )
+            {
+                Resolved++;
+            }
+        }
+        const size_t Allocations = AllocationCount - Before;
+        std::cout << "Allocations per resolve: " 
+            << static_cast<double>( Allocations ) / Iterations << std::endl;
+        if( Resolved == Iterations && Allocations == Iterations )
+        {
+            Result = TS_Success;
+        }
+    }
+    catch( const std::exception &e )
+    {
+        PrintException( __func__, e );
+    }
+
+    return Result;
+}
+
+// Resolving a registered instance only copies the stored
+// shared_ptr and a failed resolution returns an empty pointer.
+// Neither may allocate.
+static TestStatus TestInstanceAndMissResolutionDoNotAllocate()
+{
+    TestStatus Result = TS_Registration_Error;
+    ioc::container Container;
+    try
+    {
+        std::shared_ptr<InterfaceType> Instance( new Concretion() );
+        Container.register_instance<InterfaceType>( Instance );
+        const std::string Name( "NotRegistered" );
+        Result = TS_Resolution_Error;
+
+        const size_t Iterations = 100;
+        const size_t Before = AllocationCount;
+        size_t Resolved = 0;
+        size_t Missed = 0;
+        for( size_t i = 0; i < Iterations; i++ )
+        {
+            if( Container.resolve<InterfaceType>() == Instance )
+            {
+                Resolved++;
+            }
+            if( !Container.resolve<Concretion>().get() &&
+                    !Container.resolve_by_name<InterfaceType>( Name ).get() )
+            {
+                Missed++;
+            }
+        }
+        // The container resolves itself without taking ownership
+        std::shared_ptr<ioc::container> Self = Container.resolve<ioc::container>();
+        const size_t Allocations = AllocationCount - Before;
+        std::cout << "Allocations for instance and failed resolution: " 
+            << Allocations << std::endl;
+        if( Resolved == Iterations && Missed == Iterations && 
+                Allocations == 0 && Self.get() == &Container &&
+                Instance.use_count() == 2 )
+        {
+            Result = TS_Success;
+        }
+    }
+    catch( const std::exception &e )
+    {
+        PrintException( __func__, e );
+    }
+
+    return Result;
+}
+
+// A concurrent container can be resolved from several threads
+// while another thread keeps registering and removing types.
+static TestStatus TestConcurrentResolveDuringRegistration()
+{
+    TestStatus Result = TS_Registration_Error;
+    ioc::container Container( ioc::container::concurrent );
+    try
+    {
+        Container.register_type<InterfaceType, Concretion>();
+        Result = TS_Resolution_Error;
+
+        std::atomic<bool> Done( false );
+        std::atomic<size_t> Failures( 0 );
+        std::vector<std::thread> Readers;
+        for( size_t i = 0; i < 4; i++ )
+        {
+            Readers.push_back( std::thread( [&Container, &Done, &Failures]()
+                        {
+                            while( !Done.load() )
+                            {
+                                std::shared_ptr<InterfaceType> Inst = 
+                                    Container.resolve<InterfaceType>();
+                                if( !Inst.get() || !Inst->Success() )
+                                {
+                                    Failures++;
+                                }
+                                // May or may not be registered right now
+                                Container.resolve_by_name<Concretion>( "Transient" );
+                            }
+                        } ) );
+        }
+
+        for( size_t i = 0; i < 1000; i++ )
+        {
+            Container.register_type_with_name<Concretion, Concretion>( "Transient" );
+            Container.register_type_with_name<InterfaceType, Concretion>( 
+                    "Name" + std::to_string( i ) );
+            Container.remove_registration<Concretion>();
+        }
+        Done = true;
+        for( size_t i = 0; i < Readers.size(); i++ )
+        {
+            Readers[i].join();
+        }
+
+        if( Failures == 0 && 
+                Container.type_is_registered<InterfaceType>( "Name999" ) &&
+                !Container.type_is_registered<Concretion>() )
+        {
+            Result = TS_Success;
+        }
+    }
+    catch( const std::exception &e )
+    {
+        PrintException( __func__, e );
+    }
+
+    return Result;
+}
+
+// A frozen container resolves everything registered before it was
+// frozen, by type and by name, and refuses any further changes.
+static TestStatus TestFreeze()
+{
+    TestStatus Result = TS_Registration_Error;
+    ioc::container Container;
+    try
+    {
+        const size_t Count = 100;
+        Container.register_type<Concretion, Concretion>();
+        for( size_t i = 0; i < Count; i++ )
+        {
+            Container.register_type_with_name<InterfaceType, Concretion>( 
+                    "Name" + std::to_string( i ) );
+        }
+        Container.freeze();
+        Result = TS_Resolution_Error;
+
+        size_t Found = 0;
+        for( size_t i = 0; i < Count; i++ )
+        {
+            std::shared_ptr<InterfaceType> Inst = Container.resolve_by_name<InterfaceType>( 
+                    "Name" + std::to_string( i ) );
+            if( Inst.get() && Inst->Success() )
+            {
+                Found++;
+            }
+        }
+        const bool Lookups = Found == Count &&
+            Container.resolve<Concretion>().get() &&
+            Container.resolve<InterfaceType>().get() &&
+            !Container.type_is_registered<InterfaceType>( "Missing" ) &&
+            !Container.type_is_registered<ComplexConcretion>();
+
+        bool Refused = false;
+        try
+        {
+            Container.register_type<ComplexConcretion, ComplexConcretion, Concretion>();
+        }
+        catch( const ioc::frozen_container_exception &e )
+        {
+            PrintException( __func__, e );
+            Refused = true;
+        }
+
+        if( Lookups && Refused && Container.is_frozen() )
+        {
+            Result = TS_Success;
+        }
+    }
+    catch( const std::exception &e )
+    {
+        PrintException( __func__, e );
+    }
+
+    return Result;
+}
+
+// Resolve ComplexConcretion from several threads which all start
+// together and return the number of failed resolutions.
+static size_t ResolveFromManyThreads( const ioc::container &Container )
+{
+    const size_t ThreadCount = 8;
+    std::atomic<size_t> Ready( 0 );
+    std::atomic<size_t> Failures( 0 );
+    std::vector<std::thread> Threads;
+    for( size_t i = 0; i < ThreadCount; i++ )
+    {
+        Threads.push_back( std::thread( [&Container, &Ready, &Failures, ThreadCount]()
+                    {
+                        // Start resolving together
+                        Ready++;
+                        while( Ready.load() < ThreadCount )
+                        {
+                            std::this_thread::yield();
+                        }
+                        for( size_t j = 0; j < 100; j++ )
+                        {
+                            std::shared_ptr<ComplexConcretion> Inst = 
+                                Container.resolve<ComplexConcretion>();
+                            if( !Inst.get() || !Inst->InnerInstance.get() )
+                            {
+                                Failures++;
+                            }
+                        }
+                    } ) );
+    }
+    for( size_t i = 0; i < ThreadCount; i++ )
+    {
+        Threads[i].join();
+    }
+    return Failures;
+}
+
+// A single_threaded container may be resolved from many threads at
+// once while nothing is registered, and a frozen one at any time.
+// Each time the program compiled for ComplexConcretion before the
+// last registration is out of date, so the first resolutions replace
+// it while other threads may still be reading it.
+static TestStatus TestResolveStaleProgramsFromManyThreads()
+{
+    TestStatus Result = TS_Registration_Error;
+    ioc::container Container;
+    try
+    {
+        Container.register_type<Concretion, Concretion>();
+        Container.register_type<ComplexConcretion, ComplexConcretion, Concretion>();
+        Container.resolve<ComplexConcretion>();
+        Container.register_type<InterfaceType, Concretion>();
+        Result = TS_Resolution_Error;
+
+        const size_t Unfrozen = ResolveFromManyThreads( Container );
+        Container.register_type_with_name<InterfaceType, Concretion>( "Named" );
+        Container.freeze();
+        const size_t Frozen = ResolveFromManyThreads( Container );
+
+        if( Unfrozen == 0 && Frozen == 0 )
+        {
+            Result = TS_Success;
+        }
+    }
+    catch( const std::exception &e )
+    {
+        PrintException( __func__, e );
+    }
+
+    return Result;
+}
+
+// Factories cache the factories of their dependencies. Changing a
+// dependency's registration must be picked up by the next resolution.
+static TestStatus TestDependencyReregistration()
+{
+    TestStatus Result = TS_Registration_Error;
+    ioc::container Container;
+    try
+    {
+        Container.register_type<Concretion, Concretion>();
+        Container.register_type<ComplexConcretion, 
+            ComplexConcretion, Concretion>();
+        Result = TS_Resolution_Error;
+
+        std::shared_ptr<ComplexConcretion> First = 
+            Container.resolve<ComplexConcretion>();
+
+        std::shared_ptr<Concretion> Instance( new Concretion() );
+        Container.remove_registration<Concretion>();
+        Container.register_instance<Concretion>( Instance );
+        std::shared_ptr<ComplexConcretion> Second = 
+            Container.resolve<ComplexConcretion>();
+
+        Container.remove_registration<Concretion>();
+        std::shared_ptr<ComplexConcretion> Third = 
+            Container.resolve<ComplexConcretion>();
+
+        if( First.get() && First->InnerInstance.get() &&
+                First->InnerInstance != Instance &&
+                Second.get() && Second->InnerInstance == Instance &&
+                Third.get() && !Third->InnerInstance.get() )
+        {
+            Result = TS_Success;
+        }
+    }
+    catch( const std::exception &e )
+    {
+        PrintException( __func__, e );
+    }
+
+    return Result;
+}
+
+// Delegate which wraps its resolved dependency
+static InterfaceType *CreateComplexConcretion( std::shared_ptr<Concretion> Inner )
+{
+    return new ComplexConcretion( Inner );
+}
+
+// A dependency graph mixing singleton, delegate and
+// constructed nodes is flattened into one construction
+// program. Each node must keep its own lifetime rules.
+static TestStatus TestMixedDependencyGraph()
+{
+    TestStatus Result = TS_Registration_Error;
+    ioc::container Container;
+    try
+    {
+        Container.register_singleton<Concretion, Concretion>();
+        Container.register_delegate<InterfaceType, 
+            InterfaceType *(*)( std::shared_ptr<Concretion> ), Concretion>( 
+                    CreateComplexConcretion );
+        Container.register_type<CompositeType, CompositeType, 
+            Concretion, InterfaceType, Concretion>();
+        Result = TS_Resolution_Error;
+
+        std::shared_ptr<CompositeType> First = Container.resolve<CompositeType>();
+        std::shared_ptr<CompositeType> Second = Container.resolve<CompositeType>();
+        const ComplexConcretion *Complex = First.get() ?
+            dynamic_cast<const ComplexConcretion *>( First->Interface.get() ) : NULL;
+
+        if( Complex && Second.get() && First->Concrete1.get() &&
+                First->Concrete1 == First->Concrete2 &&
+                First->Concrete1 == Second->Concrete1 &&
+                Complex->InnerInstance == First->Concrete1 &&
+                First->Interface != Second->Interface )
+        {
+            Result = TS_Success;
+        }
+    }
+    catch( const std::exception &e )
+    {
+        PrintException( __func__, e );
+    }
+
+    return Result;
+}
+
+// Compile time bindings resolve without the runtime container
+// and defer anything unbound to it.
+static TestStatus TestStaticContainer()
+{
+    TestStatus Result = TS_Registration_Error;
+    ioc::container Container;
+    try
+    {
+        Container.register_type<Concretion, Concretion>();
+        Container.register_type<ComplexConcretion, ComplexConcretion, Concretion>();
+        Result = TS_Resolution_Error;
+
+        typedef ioc::static_container<
+            ioc::bind<InterfaceType, Concretion>,
+            ioc::bind_singleton<Concretion, Concretion>,
+            ioc::bind<CompositeType, CompositeType, 
+                Concretion, InterfaceType, Concretion>> StaticContainer;
+        StaticContainer Static( Container );
+        const StaticContainer Unbacked;
+
+        std::shared_ptr<CompositeType> First = Static.resolve<CompositeType>();
+        std::shared_ptr<CompositeType> Second = Static.resolve<CompositeType>();
+        std::shared_ptr<ComplexConcretion> Dynamic = 
+            Static.resolve<ComplexConcretion>();
+        std::shared_ptr<ComplexConcretion> Missing = 
+            Unbacked.resolve<ComplexConcretion>();
+
+        if( First.get() && Second.get() && First->Concrete1.get() &&
+                First->Concrete1 == First->Concrete2 &&
+                First->Concrete1 == Second->Concrete1 &&
+                First->Interface.get() && First->Interface->Success() &&
+                First->Interface != Second->Interface &&
+                Dynamic.get() && Dynamic->InnerInstance.get() &&
+                Dynamic->InnerInstance != First->Concrete1 &&
+                !Missing.get() &&
+                StaticContainer::is_bound<InterfaceType>() &&
+                !StaticContainer::is_bound<ComplexConcretion>() )
+        {
+            Result = TS_Success;
+        }
+    }
+    catch( const std::exception &e )
+    {
+        PrintException( __func__, e );
+    }
+
+    return Result;
+}
+
 // Helper macro for registering tests with a name.
 #define REGISTER_TEST( v, x ) ( v.push_back( TestFunctionObject( #x, &x ) ) ) 
 // Register all test functions within this function
@@ -590,6 +2026,34 @@ static std::vector<TestFunctionObject> GetRegisteredTests()
     REGISTER_TEST( Result, TestRemoveRegistrationByName );
     REGISTER_TEST( Result, TestRegisterDelegate );
     REGISTER_TEST( Result, TestRegisterDelegateWithName );
+    REGISTER_TEST( Result, TestManyNamedRegistrations );
+    REGISTER_TEST( Result, TestUnnamedLookupDoesNotAllocate );
+    REGISTER_TEST( Result, TestRegistrationsAreIsolatedPerContainer );
+    REGISTER_TEST( Result, TestRegisterSingleton );
+    REGISTER_TEST( Result, TestRegisterScoped );
+    REGISTER_TEST( Result, TestScopeEndingWithOutstandingReference );
+    REGISTER_TEST( Result, TestResolveAllocatesOnce );
+    REGISTER_TEST( Result, TestInstanceAndMissResolutionDoNotAllocate );
+    REGISTER_TEST( Result, TestConcurrentResolveDuringRegistration );
+    REGISTER_TEST( Result, TestFreeze );
+    REGISTER_TEST( Result, TestResolveStaleProgramsFromManyThreads );
+    REGISTER_TEST( Result, TestDependencyReregistration );
+    REGISTER_TEST( Result, TestMixedDependencyGraph );
+    REGISTER_TEST( Result, TestStaticContainer );
+    REGISTER_TEST( Result, TestNamedLookupDoesNotAllocate );
+    REGISTER_TEST( Result, TestNameIds );
+    REGISTER_TEST( Result, TestHashedNames );
+    REGISTER_TEST( Result, TestHandles );
+    REGISTER_TEST( Result, TestMemoryResource );
+    REGISTER_TEST( Result, TestReclaimWhileResolving );
+    REGISTER_TEST( Result, TestPooledRegistration );
+    REGISTER_TEST( Result, TestLocalPointers );
+    REGISTER_TEST( Result, TestResolveRef );
+    REGISTER_TEST( Result, TestDependenciesAreMovedIntoConstructors );
+    REGISTER_TEST( Result, TestResolveAll );
+    REGISTER_TEST( Result, TestResolveAllKeepsOtherResolutionsApart );
+    REGISTER_TEST( Result, TestPerGraphRegistration );
+    REGISTER_TEST( Result, TestPerGraphUnderSharedLifetimes );
     return Result;
 }
 #undef REGISTER_TEST